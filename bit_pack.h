@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define BIT_PACK_SSE2
+#endif
+
+// direct access to the words of a std::vector<bool>. This uses implementation details of libstdc++ (the
+// _Bit_type word type and the iterator's word pointer), so is only enabled when compiling against libstdc++
+// with 64-bit words. With other standard libraries (MSVC's, libc++) std::vector<bool> is converted one bit at
+// a time through its public interface. Define BIT_PACK_HAVE_VECTOR_WORDS to 0 to always do so
+#if !defined(BIT_PACK_HAVE_VECTOR_WORDS)
+#   if defined(__GLIBCXX__) && !defined(_LIBCPP_VERSION) && !defined(_MSC_VER) && defined(__SIZEOF_LONG__) && __SIZEOF_LONG__ == 8
+#       define BIT_PACK_HAVE_VECTOR_WORDS 1
+#   else
+#       define BIT_PACK_HAVE_VECTOR_WORDS 0
+#   endif
+#endif
+
+// kernels for converting between arrays of bools (one byte per value, each 0 or 1, such as
+// MATLAB's mxLogical) and bits packed into 64-bit words (least significant bit first). Both directions
+// use AVX2 or SSE2 where available (32 or 16 values per instruction sequence), else SWAR (SIMD within a
+// register), 8 values at a time.
+// NB: the SWAR paths assume a little-endian machine.
+namespace bit_pack
+{
+#if BIT_PACK_HAVE_VECTOR_WORDS
+    static_assert(std::is_same_v<std::_Bit_type, uint64_t>);
+    inline const uint64_t* vector_words(const std::vector<bool>& v_) { return v_.begin()._M_p; }
+    inline       uint64_t* vector_words(      std::vector<bool>& v_) { return v_.begin()._M_p; }
+#endif
+
+    // expand 8 bits into 8 bytes, each 0 or 1
+    inline uint64_t expand_byte(uint64_t b_)
+    {
+        // replicate byte into each byte, keep bit j in byte j, then turn each non-zero byte into 1
+        const uint64_t t = ((b_ & 0xFF) * 0x0101010101010101ull) & 0x8040201008040201ull;
+        return ((t + 0x7F7F7F7F7F7F7F7Full) >> 7) & 0x0101010101010101ull;
+    }
+    // pack 8 bytes, each 0 or 1, into 8 bits
+    inline uint64_t pack_bytes(uint64_t x_)
+    {
+        // multiplication gathers byte i into bit i of the top byte
+        return ((x_ & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56;
+    }
+
+    // unpack nBits_ bits from words_ into out_
+    inline void unpack(const uint64_t* words_, size_t nBits_, bool* out_)
+    {
+        const size_t nFull = nBits_ / 64;
+        for (size_t w = 0; w < nFull; w++)
+        {
+            const uint64_t word = words_[w];
+            bool* out = out_ + 64 * w;
+#if defined(__AVX2__)
+            // broadcast 32 bits, route byte j/8 of them to byte j, keep bit j%8, then turn non-zero bytes into 1
+            const __m256i route = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                                   2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+            const __m256i bit   = _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ull));
+            const __m256i one   = _mm256_set1_epi8(1);
+            for (size_t b = 0; b < 2; b++)
+            {
+                const __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(word >> (32 * b))), route);
+                const __m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v, bit), bit), one);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32 * b), m);
+            }
+#elif defined(BIT_PACK_SSE2)
+            // as above, with byte j/8 routed to byte j by unpacking the bytes with themselves (no pshufb in SSE2)
+            const __m128i bit = _mm_set1_epi64x(static_cast<long long>(0x8040201008040201ull));
+            const __m128i one = _mm_set1_epi8(1);
+            for (size_t b = 0; b < 4; b++)
+            {
+                __m128i v = _mm_cvtsi32_si128(static_cast<int>((word >> (16 * b)) & 0xFFFF));
+                v = _mm_unpacklo_epi8(v, v);
+                v = _mm_unpacklo_epi16(v, v);
+                v = _mm_unpacklo_epi32(v, v);
+                const __m128i m = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, bit), bit), one);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * b), m);
+            }
+#else
+            for (size_t b = 0; b < 8; b++)
+            {
+                const uint64_t bytes = expand_byte(word >> (8 * b));
+                std::memcpy(out + 8 * b, &bytes, 8);
+            }
+#endif
+        }
+        for (size_t i = 64 * nFull; i < nBits_; i++)
+            out_[i] = (words_[i / 64] >> (i % 64)) & 1;
+    }
+
+    // pack n_ bools from in_ into words_. Unused bits in the last word are set to zero
+    inline void pack(const bool* in_, size_t n_, uint64_t* words_)
+    {
+        const size_t nFull = n_ / 64;
+        for (size_t w = 0; w < nFull; w++)
+        {
+            const bool* in = in_ + 64 * w;
+            uint64_t word = 0;
+#if defined(__AVX2__)
+            const __m256i zero = _mm256_setzero_si256();
+            for (size_t b = 0; b < 2; b++)
+            {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32 * b));
+                const uint32_t m = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+                word |= static_cast<uint64_t>(m) << (32 * b);
+            }
+#elif defined(BIT_PACK_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            for (size_t b = 0; b < 4; b++)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16 * b));
+                const uint32_t m = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) & 0xFFFF;
+                word |= static_cast<uint64_t>(m) << (16 * b);
+            }
+#else
+            for (size_t b = 0; b < 8; b++)
+            {
+                uint64_t bytes;
+                std::memcpy(&bytes, in + 8 * b, 8);
+                word |= pack_bytes(bytes) << (8 * b);
+            }
+#endif
+            words_[w] = word;
+        }
+        if (const size_t rem = n_ % 64)
+        {
+            uint64_t word = 0;
+            for (size_t i = 0; i < rem; i++)
+                word |= static_cast<uint64_t>(in_[64 * nFull + i] != 0) << i;
+            words_[nFull] = word;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+
+// cache-blocked transposition of (part of) a column-major matrix, as MATLAB stores them, into row-major order:
+// out_[r*nCol_ + c] = in_[r + c*ld_], for r in [0, nRow_), c in [0, nCol_)
+// ld_ is the distance between the input's columns: its number of rows, or more if only some of the rows of a
+// taller matrix are transposed. A plain loop over the rows reads with a stride of a full column, which for tall
+// matrices touches a new cache line (and often a new page) for every element. Instead the matrix is processed in
+// tiles that fit in L1 together with their output, and with AVX2 4x4 (8-byte elements) or 8x8 (4-byte elements)
+// blocks of a tile are transposed in registers. Matrices narrower than such a block (e.g. Nx3 doubles) are not
+// tiled: a plain loop over their rows reads only a few sequential streams, which the hardware prefetchers
+// follow, and is bound by memory bandwidth (as fast as the tiled loops, also when transposing 4 resp. 8 rows
+// at a time in registers). If NCol is non-zero, it is the number of columns (nCol_ is ignored), known at
+// compile time so that the loops over the columns of narrow matrices can be unrolled
+namespace blocked_transpose
+{
+    inline constexpr size_t tile = 32;  // tiles of 32x32 elements: 8 KiB in and 8 KiB out for 8-byte elements
+
+    namespace detail
+    {
+        template <typename T>
+        void tileScalar(const T* in_, size_t ld_, size_t nRow_, size_t nCol_, T* out_, size_t ldOut_)
+        {
+            for (size_t r = 0; r < nRow_; r++)
+                for (size_t c = 0; c < nCol_; c++)
+                    out_[r * ldOut_ + c] = in_[r + c * ld_];
+        }
+
+#if defined(__AVX2__)
+        // NB: only shuffles, no arithmetic, so also used for 8-byte and 4-byte integers
+        template <typename T>
+        void block4x4(const T* in_, size_t ld_, T* out_, size_t ldOut_)
+        {
+            const auto in  = reinterpret_cast<const double*>(in_);
+            const auto out = reinterpret_cast<double*>(out_);
+            const __m256d a0 = _mm256_loadu_pd(in);
+            const __m256d a1 = _mm256_loadu_pd(in + ld_);
+            const __m256d a2 = _mm256_loadu_pd(in + 2 * ld_);
+            const __m256d a3 = _mm256_loadu_pd(in + 3 * ld_);
+            const __m256d t0 = _mm256_unpacklo_pd(a0, a1);
+            const __m256d t1 = _mm256_unpackhi_pd(a0, a1);
+            const __m256d t2 = _mm256_unpacklo_pd(a2, a3);
+            const __m256d t3 = _mm256_unpackhi_pd(a2, a3);
+            _mm256_storeu_pd(out,               _mm256_permute2f128_pd(t0, t2, 0x20));
+            _mm256_storeu_pd(out + ldOut_,      _mm256_permute2f128_pd(t1, t3, 0x20));
+            _mm256_storeu_pd(out + 2 * ldOut_,  _mm256_permute2f128_pd(t0, t2, 0x31));
+            _mm256_storeu_pd(out + 3 * ldOut_,  _mm256_permute2f128_pd(t1, t3, 0x31));
+        }
+        template <typename T>
+        void block8x8(const T* in_, size_t ld_, T* out_, size_t ldOut_)
+        {
+            const auto in  = reinterpret_cast<const float*>(in_);
+            const auto out = reinterpret_cast<float*>(out_);
+            __m256 a[8], t[8];
+            for (size_t i = 0; i < 8; i++)
+                a[i] = _mm256_loadu_ps(in + i * ld_);
+            for (size_t i = 0; i < 8; i += 2)
+            {
+                t[i]     = _mm256_unpacklo_ps(a[i], a[i + 1]);
+                t[i + 1] = _mm256_unpackhi_ps(a[i], a[i + 1]);
+            }
+            for (size_t i = 0; i < 8; i += 4)
+            {
+                a[i]     = _mm256_shuffle_ps(t[i],     t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+                a[i + 1] = _mm256_shuffle_ps(t[i],     t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+                a[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+                a[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+            }
+            for (size_t i = 0; i < 4; i++)
+            {
+                _mm256_storeu_ps(out + i * ldOut_,       _mm256_permute2f128_ps(a[i], a[i + 4], 0x20));
+                _mm256_storeu_ps(out + (i + 4) * ldOut_, _mm256_permute2f128_ps(a[i], a[i + 4], 0x31));
+            }
+        }
+#endif
+
+        template <typename T>
+        void transposeTile(const T* in_, size_t ld_, size_t nRow_, size_t nCol_, T* out_, size_t ldOut_)
+        {
+#if defined(__AVX2__)
+            if constexpr (std::is_arithmetic_v<T> && (sizeof(T) == 8 || sizeof(T) == 4))
+            {
+                constexpr size_t b = 32 / sizeof(T);
+                const size_t nRowB = nRow_ / b * b;
+                const size_t nColB = nCol_ / b * b;
+                for (size_t r = 0; r < nRowB; r += b)
+                    for (size_t c = 0; c < nColB; c += b)
+                    {
+                        if constexpr (b == 4)
+                            block4x4(in_ + r + c * ld_, ld_, out_ + r * ldOut_ + c, ldOut_);
+                        else
+                            block8x8(in_ + r + c * ld_, ld_, out_ + r * ldOut_ + c, ldOut_);
+                    }
+                // remaining columns of the full blocks' rows, then the remaining rows
+                tileScalar(in_ + nColB * ld_, ld_, nRowB, nCol_ - nColB, out_ + nColB, ldOut_);
+                tileScalar(in_ + nRowB, ld_, nRow_ - nRowB, nCol_, out_ + nRowB * ldOut_, ldOut_);
+                return;
+            }
+#endif
+            tileScalar(in_, ld_, nRow_, nCol_, out_, ldOut_);
+        }
+    }
+
+    template <size_t NCol = 0, typename T>
+    void toRowMajor(const T* in_, size_t ld_, size_t nRow_, size_t nCol_, T* out_)
+    {
+        const size_t nCol = NCol ? NCol : nCol_;
+        if (nCol * sizeof(T) < 32)
+        {
+            detail::tileScalar(in_, ld_, nRow_, nCol, out_, nCol);
+            return;
+        }
+        for (size_t r = 0; r < nRow_; r += tile)
+        {
+            const size_t nr = std::min(tile, nRow_ - r);
+            for (size_t c = 0; c < nCol; c += tile)
+                detail::transposeTile(in_ + r + c * ld_, ld_, nr, std::min(tile, nCol - c), out_ + r * nCol + c, nCol);
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
+
+// string literal that can be used as a non-type template argument, e.g. Command<"init">
+template <std::size_t N>
+struct fixed_string
+{
+    char value[N]{};
+
+    constexpr fixed_string(const char (&str_)[N])
+    {
+        std::copy_n(str_, N, value);
+    }
+
+    constexpr std::string_view view() const { return { value, N - 1 }; }
+    constexpr operator std::string_view() const { return view(); }
+};
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+// Per-call scratch memory. Conversion code needs many short-lived temporaries (field name arrays,
+// intermediate strings, etc). Instead of allocating these on the general heap, they are allocated from
+// a monotonic arena. An ArenaScope rewinds the arena to where it was when the scope was entered, so
+// that all memory allocated within the scope is reused. Memory blocks are kept when rewinding, so once
+// the arena has grown to the size a call needs, calls no longer cause any heap allocations for scratch
+// memory.
+//
+// The arena is a std::pmr::memory_resource, and can also be used by user code for temporaries that
+// do not outlive the call, e.g.:
+// void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+// {
+//     mxTypes::ArenaScope scope;      // NB: Dispatcher already does this for each call
+//     std::pmr::vector<double> tmp(mxTypes::Scratch());
+//     ...
+// }
+// Deallocation is a no-op, memory is only reclaimed when the enclosing scope ends. There is one arena
+// per thread. Library functions that use scratch memory open their own ArenaScope, so they don't
+// accumulate memory when called outside of one.
+namespace mxTypes
+{
+    class Arena final : public std::pmr::memory_resource
+    {
+    public:
+        static constexpr size_t initialBlockSize = size_t{ 64 } << 10;
+
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // position in the arena, for rewinding
+        struct Mark
+        {
+            size_t block;
+            size_t offset;
+        };
+        Mark mark() const { return { _block, _offset }; }
+        // make memory allocated since the mark was taken available again (that memory becomes invalid)
+        void rewind(Mark mark_)
+        {
+            _block  = mark_.block;
+            _offset = mark_.offset;
+        }
+        // make all memory available again (all previously allocated memory becomes invalid)
+        void reset()
+        {
+            rewind({ 0, 0 });
+        }
+        // reset, and give back all but the first block to the system
+        void trim()
+        {
+            reset();
+            if (_blocks.size() > 1)
+                _blocks.resize(1);
+        }
+
+        size_t capacity() const
+        {
+            size_t out = 0;
+            for (auto&& b : _blocks)
+                out += b.size;
+            return out;
+        }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> data;
+            size_t                       size;
+        };
+
+        void* do_allocate(size_t bytes_, size_t alignment_) override
+        {
+            // try current block, then further blocks that are kept from before the last reset
+            for (; _block < _blocks.size(); _block++, _offset = 0)
+            {
+                auto& b = _blocks[_block];
+                const auto base    = reinterpret_cast<uintptr_t>(b.data.get());
+                const auto aligned = (base + _offset + alignment_ - 1) & ~(static_cast<uintptr_t>(alignment_) - 1);
+                if (aligned + bytes_ <= base + b.size)
+                {
+                    _offset = aligned + bytes_ - base;
+                    return reinterpret_cast<void*>(aligned);
+                }
+            }
+            // need a new block, grow geometrically
+            const size_t size = std::max({ initialBlockSize, _blocks.empty() ? 0 : 2 * _blocks.back().size, bytes_ + alignment_ });
+            _blocks.push_back({ std::make_unique<std::byte[]>(size), size });
+            _block  = _blocks.size() - 1;
+            _offset = 0;
+            return do_allocate(bytes_, alignment_);
+        }
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other_) const noexcept override
+        {
+            return this == &other_;
+        }
+
+        std::vector<Block>  _blocks;
+        size_t              _block  = 0;
+        size_t              _offset = 0;
+    };
+
+    // the calling thread's scratch arena
+    inline Arena* Scratch()
+    {
+        thread_local Arena arena;
+        return &arena;
+    }
+
+    // rewinds the calling thread's scratch arena to where it was when the scope was entered
+    class ArenaScope
+    {
+    public:
+        ArenaScope() : _mark(Scratch()->mark()) {}
+        ~ArenaScope() { Scratch()->rewind(_mark); }
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+
+    private:
+        Arena::Mark _mark;
+    };
+}
@@ -0,0 +1,392 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mex_type_utils.h"
+#include "mex_conversion_plan.h"
+#include "worker_pool.h"
+
+// asynchronous export, so that huge exports do not block the MATLAB interpreter. All C++-side work
+// (filtering, type conversion, string transcoding) is done on a background thread, into staging buffers
+// that have the exact memory layout of the MATLAB arrays to be created. A later mex call then fetches the
+// result, which only allocates the mxArrays and memcpys the staged buffers into them.
+//
+// The data to export is moved into the background job (it is not copied), together with a stager: a
+// callable that turns it into a Staged output, typically through Stage(), StageField() or StageFields().
+// e.g., in a Dispatcher-based mex file:
+// uint64_t startExport()
+// {
+//     return mxTypes::AsyncExport(std::move(_samples), [](const auto& s_)
+//     {
+//         return mxTypes::StageFields(s_, mxTypes::Where{ isValid }, false, Column("ts", &Sample::ts), Column("label", &Sample::label));
+//     });
+// }
+// mxArray* fetchExport(uint64_t ticket_)
+// {
+//     auto out = mxTypes::FetchExport(ticket_);    // nullptr while the job is still running
+//     return out ? out : mxCreateDoubleMatrix(0, 0, mxREAL);
+// }
+//
+// Jobs run on worker_pool::Default() unless another pool is specified. Tickets and results are held in a
+// process-wide registry that must only be accessed from the mex thread. Errors throw a std::string, an
+// exception thrown by the stager is rethrown by FetchExport()
+namespace mxTypes
+{
+    // output staged for conversion to MATLAB: a tree of numeric/char arrays, cell arrays and (scalar)
+    // structs. Convert with ToMatlab()
+    class Staged
+    {
+    public:
+        Staged() = default;
+
+        // numeric (or logical) array of class typeToMxClass_v<T>, storage for numel elements, contents undefined
+        template <typename T>
+        static Staged Numeric(mwSize rows_, mwSize cols_)
+        {
+            Staged out(Kind::Array, typeToMxClass_v<T>, rows_, cols_);
+            out._bytes.reset(new std::byte[static_cast<size_t>(rows_) * cols_ * sizeof(T)]);
+            out._elemSize = sizeof(T);
+            return out;
+        }
+        // char array holding the given UTF-8 string (up to the first NUL, like mxCreateString, see the
+        // notes on transcoding in mex_conversion_plan.h)
+        static Staged String(const std::string& str_)
+        {
+            const auto s = detail::cStringView(str_);
+            const auto dims = detail::charDims(detail::utf16Length(s));
+            Staged out(Kind::Array, mxCHAR_CLASS, dims[0], dims[1]);
+            out._bytes.reset(new std::byte[static_cast<size_t>(out._rows) * out._cols * sizeof(mxChar)]);
+            out._elemSize = sizeof(mxChar);
+            detail::utf8ToUtf16(s, reinterpret_cast<mxChar*>(out._bytes.get()));
+            return out;
+        }
+        static Staged Cell(mwSize rows_, mwSize cols_)
+        {
+            Staged out(Kind::Cell, mxCELL_CLASS, rows_, cols_);
+            out._children.resize(static_cast<size_t>(rows_) * cols_);
+            return out;
+        }
+        static Staged Struct(std::vector<const char*> fieldNames_)
+        {
+            Staged out(Kind::Struct, mxSTRUCT_CLASS, 1, 1);
+            out._children.resize(fieldNames_.size());
+            out._fieldNames = std::move(fieldNames_);
+            return out;
+        }
+
+        // element storage of a numeric array
+        template <typename T>
+        T* data() { return reinterpret_cast<T*>(_bytes.get()); }
+        // cell elements, or struct fields
+        Staged& child(size_t i_) { return _children[i_]; }
+
+        mxArray* toMatlab() const
+        {
+            switch (_kind)
+            {
+                case Kind::Array:
+                {
+                    mxArray* out = mxCreateUninitNumericMatrix(_rows, _cols, _class, mxREAL);
+                    if (const auto nByte = static_cast<size_t>(_rows) * _cols * _elemSize)
+                        std::memcpy(mxGetData(out), _bytes.get(), nByte);
+                    return out;
+                }
+                case Kind::Cell:
+                {
+                    mxArray* out = mxCreateCellMatrix(_rows, _cols);
+                    for (size_t i = 0; i < _children.size(); i++)
+                        mxSetCell(out, static_cast<mwIndex>(i), _children[i].toMatlab());
+                    return out;
+                }
+                case Kind::Struct:
+                default:
+                {
+                    mxArray* out = mxCreateStructMatrix(1, 1, static_cast<int>(_fieldNames.size()), const_cast<const char**>(_fieldNames.data()));
+                    for (size_t f = 0; f < _children.size(); f++)
+                        mxSetFieldByNumber(out, 0, static_cast<int>(f), _children[f].toMatlab());
+                    return out;
+                }
+            }
+        }
+
+    private:
+        enum class Kind { Array, Cell, Struct };
+        Staged(Kind kind_, mxClassID class_, mwSize rows_, mwSize cols_) : _kind(kind_), _class(class_), _rows(rows_), _cols(cols_) {}
+
+        Kind                         _kind  = Kind::Array;
+        mxClassID                    _class = mxDOUBLE_CLASS;
+        mwSize                       _rows  = 0;
+        mwSize                       _cols  = 0;
+        size_t                       _elemSize = 0;
+        std::unique_ptr<std::byte[]> _bytes;
+        std::vector<Staged>          _children;
+        std::vector<const char*>     _fieldNames;  // NB: names are string literals (from Column()), not owned
+    };
+
+    inline mxArray* ToMatlab(const Staged& staged_)
+    {
+        return staged_.toMatlab();
+    }
+
+    //// staging, mirroring ToMatlab(), FieldToMatlab() and FieldsToMatlab(). These do not use the mx API
+    namespace detail
+    {
+        inline std::pair<mwSize, mwSize> stagedDims(size_t n_, bool rowVector_)
+        {
+            return rowVector_ ? std::pair<mwSize, mwSize>{ 1, static_cast<mwSize>(n_) } : std::pair<mwSize, mwSize>{ static_cast<mwSize>(n_), 1 };
+        }
+
+        template <typename Cont, typename Sel, typename Path, typename Children>
+        Staged stageStruct(const Cont& data_, const Sel& selection_, bool rowVector_, const Path& path_, const Children& children_);
+    }
+
+    template <typename T, typename... Extras>
+    Staged Stage(const T& data_, Extras... extras_)
+    {
+        if constexpr (std::is_same_v<T, std::string> && sizeof...(Extras) == 0)
+            return Staged::String(data_);
+        else if constexpr (std::is_arithmetic_v<T> && sizeof...(Extras) < 2)
+        {
+            using outputType = std::tuple_element_t<0, std::tuple<Extras..., T>>;
+            auto out = Staged::Numeric<outputType>(1, 1);
+            *out.template data<outputType>() = static_cast<outputType>(data_);
+            return out;
+        }
+        else if constexpr (Chrono<T> && sizeof...(Extras) < 2 && (ChronoEncoding<Extras> && ...))
+        {
+            using E = std::tuple_element_t<0, std::tuple<Extras..., Ticks>>;
+            using Out = decltype(E{}(data_));
+            auto out = Staged::Numeric<Out>(1, 1);
+            *out.template data<Out>() = E{}(data_);
+            return out;
+        }
+        else if constexpr (Container<T>)
+        {
+            using V = typename T::value_type;
+            const auto [rCount, cCount] = detail::stagedDims(data_.size(), MEX_TYPE_UTILS_OUTPUT_ROWVECTORS);
+            if constexpr (std::is_arithmetic_v<V> && sizeof...(Extras) < 2)
+            {
+                using outputType = std::tuple_element_t<0, std::tuple<Extras..., V>>;
+                auto out = Staged::Numeric<outputType>(rCount, cCount);
+                auto storage = out.template data<outputType>();
+                for (auto&& item : data_)
+                    *storage++ = static_cast<outputType>(item);
+                return out;
+            }
+            else if constexpr (Chrono<V> && sizeof...(Extras) < 2 && (ChronoEncoding<Extras> && ...))
+            {
+                using E = std::tuple_element_t<0, std::tuple<Extras..., Ticks>>;
+                using Out = decltype(E{}(std::declval<V>()));
+                auto out = Staged::Numeric<Out>(rCount, cCount);
+                auto storage = out.template data<Out>();
+                if constexpr (ContiguousStorage<T> && detail::chronoIsRep<V>)
+                {
+                    if (!data_.empty())
+                        detail::encodeTicks<V, E>(reinterpret_cast<const typename detail::chronoTraits<V>::rep*>(&*std::cbegin(data_)), data_.size(), storage);
+                }
+                else
+                {
+                    for (auto&& item : data_)
+                        *storage++ = E{}(item);
+                }
+                return out;
+            }
+            else
+            {
+                auto out = Staged::Cell(rCount, cCount);
+                size_t i = 0;
+                for (auto&& item : data_)
+                    out.child(i++) = Stage(item, extras_...);
+                return out;
+            }
+        }
+        else
+            static_assert(always_false_t<T>, "Stage: this type cannot be staged (only arithmetic types, std::chrono values, strings, containers and struct of arrays exports through StageField(s)() are supported)");
+    }
+
+    // same as FieldToMatlab(), optionally for the selected elements only (see Selection)
+    template <typename Cont, Selection Sel, typename... Fs>
+    requires Container<Cont>
+    Staged StageField(const Cont& data_, const Sel& selection_, const bool rowVector_, Fs... fields_)
+    {
+        detail::checkSelection(data_, selection_, "StageField");
+        using V = typename Cont::value_type;
+        using U = std::decay_t<decltype(nested_field::getWrapper(std::declval<V>(), fields_...))>;
+        const size_t nElem = detail::selectionSize(data_, selection_);
+        const auto [rCount, cCount] = detail::stagedDims(nElem, rowVector_);
+
+        if constexpr (HasFieldSchema<U> && (std::is_member_object_pointer_v<Fs> && ...))
+            return detail::stageStruct(data_, selection_, rowVector_, std::make_tuple(fields_...), fieldSchema<U>::value);
+        else if constexpr (Chrono<U>)
+            // std::chrono field without encoding: default encoding
+            return StageField(data_, selection_, rowVector_, fields_..., Ticks{});
+        else if constexpr (typeNeedsMxCellStorage_v<U>)
+        {
+            auto out = Staged::Cell(rCount, cCount);
+            size_t i = 0;
+            detail::forEachSelected(data_, selection_, [&](const V& item_) { out.child(i++) = Stage(nested_field::getWrapper(item_, fields_...)); });
+            return out;
+        }
+        else
+        {
+            static_assert(typeToMxClass_v<U> != mxSTRUCT_CLASS, "To stage a field of struct type, register a fieldSchema for it (or use StageFields() with Nested())");
+            auto out = Staged::Numeric<U>(rCount, cCount);
+            auto storage = out.template data<U>();
+            if constexpr (std::is_same_v<Sel, IndexRange> && ContiguousStorage<Cont> && detail::isStridedField<V, Fs...>())
+            {
+                if (nElem)
+                {
+                    const auto field = detail::fieldAddress(*std::next(std::cbegin(data_), selection_.first), fields_...);
+                    using In = std::remove_cvref_t<decltype(*field)>;
+                    strided_gather::gather<In>(reinterpret_cast<const std::byte*>(field), sizeof(V), nElem, storage);
+                }
+            }
+            else if constexpr (std::is_same_v<Sel, IndexRange> && ContiguousStorage<Cont> && detail::isStridedChronoField<V, Fs...>())
+            {
+                if (nElem)
+                {
+                    const auto field = detail::fieldAddress(*std::next(std::cbegin(data_), selection_.first), fields_...);
+                    detail::gatherEncodeTicks<std::remove_cvref_t<decltype(*field)>, last<0, Fs...>>(reinterpret_cast<const std::byte*>(field), sizeof(V), nElem, storage);
+                }
+            }
+            else
+                detail::forEachSelected(data_, selection_, [&](const V& item_) { *storage++ = nested_field::getWrapper(item_, fields_...); });
+            return out;
+        }
+    }
+    template <typename Cont, typename... Fs>
+    requires Container<Cont>
+    Staged StageField(const Cont& data_, const bool rowVector_, Fs... fields_)
+    {
+        return StageField(data_, IndexRange{ 0, data_.size() }, rowVector_, fields_...);
+    }
+
+    // same as FieldsToMatlab(), optionally for the selected elements only (see Selection)
+    template <typename Cont, Selection Sel, typename... Cols>
+    requires Container<Cont>
+    Staged StageFields(const Cont& data_, const Sel& selection_, const bool rowVector_, Cols... columns_)
+    {
+        return detail::stageStruct(data_, selection_, rowVector_, std::tuple<>{}, std::tuple{ columns_... });
+    }
+    template <typename Cont, typename... Cols>
+    requires Container<Cont>
+    Staged StageFields(const Cont& data_, const bool rowVector_, Cols... columns_)
+    {
+        return StageFields(data_, IndexRange{ 0, data_.size() }, rowVector_, columns_...);
+    }
+
+    namespace detail
+    {
+        template <typename Cont, typename Sel, typename Path, typename Children>
+        Staged stageStruct(const Cont& data_, const Sel& selection_, bool rowVector_, const Path& path_, const Children& children_)
+        {
+            return std::apply([&](const auto&... child_)
+            {
+                static_assert(sizeof...(child_) > 0, "A nested struct must have at least one field");
+                auto out = Staged::Struct({ child_.name... });
+                size_t f = 0;
+                auto stageChild = [&]<typename C>(const C& c_)
+                {
+                    if constexpr (is_specialization_v<C, NamedColumn>)
+                        out.child(f++) = std::apply([&](auto... fields_) { return StageField(data_, selection_, rowVector_, fields_...); }, std::tuple_cat(path_, c_.fields));
+                    else
+                        out.child(f++) = stageStruct(data_, selection_, rowVector_, std::tuple_cat(path_, c_.path), c_.children);
+                };
+                (stageChild(child_), ...);
+                return out;
+            }, children_);
+        }
+
+        struct AsyncJob
+        {
+            std::atomic<bool>   done{ false };
+            Staged              result;
+            std::exception_ptr  error;
+        };
+        struct AsyncRegistry
+        {
+            uint64_t                                                nextTicket = 1;
+            std::unordered_map<uint64_t, std::shared_ptr<AsyncJob>> jobs;
+        };
+        inline AsyncRegistry& asyncRegistry()
+        {
+            static AsyncRegistry registry;
+            return registry;
+        }
+        inline std::shared_ptr<AsyncJob>& findAsyncJob(uint64_t ticket_, const char* funcID_)
+        {
+            auto& jobs = asyncRegistry().jobs;
+            const auto it = jobs.find(ticket_);
+            if (it == jobs.end())
+                throw std::string("SWAG::") + funcID_ + ": unknown export ticket " + std::to_string(ticket_) + " (already fetched or cancelled?).";
+            return it->second;
+        }
+    }
+
+    // start exporting data_ on a background thread: stager_(data_) is invoked there and should return a
+    // Staged output. data_ is moved into the job, and destroyed on the background thread once staged.
+    // Returns a ticket for use with ExportReady(), FetchExport() and CancelExport()
+    template <typename T, typename Stager>
+    uint64_t AsyncExport(T&& data_, Stager stager_, worker_pool::Pool& pool_ = worker_pool::Default())
+    {
+        static_assert(!std::is_lvalue_reference_v<T>, "AsyncExport takes ownership of the data, std::move() it in");
+        auto job  = std::make_shared<detail::AsyncJob>();
+        auto data = std::make_shared<std::decay_t<T>>(std::move(data_));
+        pool_.submit([job, data = std::move(data), stager_]() mutable
+        {
+            try
+            {
+                job->result = stager_(std::as_const(*data));
+            }
+            catch (...)
+            {
+                job->error = std::current_exception();
+            }
+            data.reset();
+            job->done.store(true, std::memory_order_release);
+        });
+        auto& registry = detail::asyncRegistry();
+        const auto ticket = registry.nextTicket++;
+        registry.jobs.emplace(ticket, std::move(job));
+        return ticket;
+    }
+    // same, staging the data with Stage()
+    template <typename T>
+    uint64_t AsyncExport(T&& data_)
+    {
+        return AsyncExport(std::forward<T>(data_), [](const auto& d_) { return Stage(d_); });
+    }
+
+    // whether the export is ready to be fetched
+    inline bool ExportReady(uint64_t ticket_)
+    {
+        return detail::findAsyncJob(ticket_, "ExportReady")->done.load(std::memory_order_acquire);
+    }
+    // the exported output, or nullptr if not yet ready. Once fetched, the ticket is no longer valid
+    inline mxArray* FetchExport(uint64_t ticket_)
+    {
+        auto job = detail::findAsyncJob(ticket_, "FetchExport");
+        if (!job->done.load(std::memory_order_acquire))
+            return nullptr;
+        detail::asyncRegistry().jobs.erase(ticket_);
+        if (job->error)
+            std::rethrow_exception(job->error);
+        return job->result.toMatlab();
+    }
+    // discard the export. A job that is still running completes in the background, its result is dropped
+    inline void CancelExport(uint64_t ticket_)
+    {
+        detail::findAsyncJob(ticket_, "CancelExport");
+        detail::asyncRegistry().jobs.erase(ticket_);
+    }
+}
@@ -0,0 +1,443 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mex_type_utils.h"
+#include "worker_pool.h"
+
+// two-phase conversion, for outputs whose conversion involves a lot of per-element C++ work (strings to
+// transcode, converters and type tag casts to run, large struct-of-arrays exports). The mx API may only
+// be used from the mex thread, so a normal conversion is serial. A ConversionPlan splits it:
+// 1. plan (mex thread): compute the shapes and classes of all outputs and create all mxArrays (cells,
+//    structs, numeric and char arrays), recording for each data buffer a fill task;
+// 2. execute: fill all data buffers using a pool of worker threads (see worker_pool.h), without any
+//    calls into the mx API.
+//
+// mxTypes::ConversionPlan plan;
+// plhs[0] = plan.FieldsToMatlab(samples, false, Column("ts", &Sample::ts), Column("label", &Sample::label));
+// plhs[1] = plan.ToMatlab(names);
+// plan.execute();
+//
+// Outputs have the same content as those of the corresponding mxTypes functions, but their data buffers
+// are undefined until execute() has returned. The converted data must remain alive and unmodified until
+// then. Containers are split over workers in blocks when they are random access, otherwise each is filled
+// by a single task (different tasks still run concurrently). Strings are transcoded from UTF-8 into
+// pre-sized char arrays (reading up to the first NUL, and empty strings giving 0x0 arrays, like
+// mxCreateString). NB: mxCreateString converts from the user's locale encoding, here the input is always
+// taken as UTF-8 (invalid sequences become U+FFFD). The results only differ for non-ASCII strings when
+// MATLAB runs with a non-UTF-8 locale (e.g. a Windows code page). Where planning needs the
+// result of a conversion (e.g. the length of a string returned by a converter), the converter is run on
+// the workers during planning and the results are kept until execute(). Types the planner does not know
+// about (e.g. user structs converted through their own ToMatlab overload) are converted directly during
+// planning.
+namespace mxTypes
+{
+    namespace detail
+    {
+        // decode the UTF-8 encoded code point at s_[i_] and advance i_ past it. Invalid sequences decode to
+        // U+FFFD, consuming one byte
+        inline char32_t decodeUtf8(std::string_view s_, size_t& i_)
+        {
+            const auto c = static_cast<unsigned char>(s_[i_]);
+            if (c < 0x80)
+            {
+                i_++;
+                return c;
+            }
+            size_t   len;
+            char32_t cp;
+            if      ((c & 0xE0) == 0xC0) { len = 2; cp = c & 0x1F; }
+            else if ((c & 0xF0) == 0xE0) { len = 3; cp = c & 0x0F; }
+            else if ((c & 0xF8) == 0xF0) { len = 4; cp = c & 0x07; }
+            else
+            {
+                i_++;
+                return 0xFFFD;
+            }
+            if (i_ + len > s_.size())
+            {
+                i_++;
+                return 0xFFFD;
+            }
+            for (size_t k = 1; k < len; k++)
+            {
+                const auto cc = static_cast<unsigned char>(s_[i_ + k]);
+                if ((cc & 0xC0) != 0x80)
+                {
+                    i_++;
+                    return 0xFFFD;
+                }
+                cp = (cp << 6) | (cc & 0x3F);
+            }
+            // reject overlong encodings, surrogates and code points beyond U+10FFFF
+            constexpr char32_t minCp[] = { 0, 0, 0x80, 0x800, 0x10000 };
+            if (cp < minCp[len] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            {
+                i_++;
+                return 0xFFFD;
+            }
+            i_ += len;
+            return cp;
+        }
+        // number of UTF-16 code units needed for the UTF-8 string s_
+        inline size_t utf16Length(std::string_view s_)
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < s_.size();)
+                n += decodeUtf8(s_, i) > 0xFFFF ? 2 : 1;
+            return n;
+        }
+        // transcode the UTF-8 string s_ into out_, which holds utf16Length(s_) code units
+        inline void utf8ToUtf16(std::string_view s_, mxChar* out_)
+        {
+            for (size_t i = 0; i < s_.size();)
+            {
+                const char32_t cp = decodeUtf8(s_, i);
+                if (cp > 0xFFFF)
+                {
+                    *out_++ = static_cast<mxChar>(0xD800 + ((cp - 0x10000) >> 10));
+                    *out_++ = static_cast<mxChar>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+                }
+                else
+                    *out_++ = static_cast<mxChar>(cp);
+            }
+        }
+        // as converted by mxCreateString
+        inline std::string_view cStringView(const std::string& s_)
+        {
+            return { s_.c_str() };
+        }
+        // dimensions of the char array holding nChar_ code units: a row, except 0x0 for an empty string
+        // (as mxCreateString(""))
+        inline std::array<mwSize, 2> charDims(size_t nChar_)
+        {
+            return nChar_ ? std::array<mwSize, 2>{ 1, static_cast<mwSize>(nChar_) } : std::array<mwSize, 2>{ 0, 0 };
+        }
+
+        // extras the planner handles itself: none, an arithmetic type tag selecting the output class, or the
+        // encoding of std::chrono values. Other tags (Ragged, Dense, EnumCodes, ...) change the output layout and
+        // are left to mxTypes
+        template <typename... Extras>
+        inline constexpr bool isPlannableTag_v = sizeof...(Extras) == 0 || (sizeof...(Extras) == 1 && ((std::is_arithmetic_v<Extras> || ChronoEncoding<Extras>) && ...));
+
+        template <typename Cont>
+        inline constexpr bool isRandomAccess_v = std::random_access_iterator<typename Cont::const_iterator>;
+    }
+
+    class ConversionPlan
+    {
+    public:
+        // element counts of the blocks a fill task is split into
+        static constexpr size_t numericGrain = size_t{ 1 } << 15;
+        static constexpr size_t stringGrain  = 256;
+
+        explicit ConversionPlan(worker_pool::Pool& pool_ = worker_pool::Default()) : _pool(pool_) {}
+        ConversionPlan(const ConversionPlan&) = delete;
+        ConversionPlan& operator=(const ConversionPlan&) = delete;
+
+        //// phase 1 (mex thread): create outputs, as the corresponding mxTypes functions
+        template <typename T, typename... Extras>
+        mxArray* ToMatlab(const T& data_, Extras... extras_)
+        {
+            return plan(data_, extras_...);
+        }
+        template <typename Cont, typename... Fs>
+        requires Container<Cont>
+        mxArray* FieldToMatlab(const Cont& data_, const bool rowVector_, Fs... fields_);
+        template <typename Cont, typename... Cols>
+        requires Container<Cont>
+        mxArray* FieldsToMatlab(const Cont& data_, const bool rowVector_, Cols... columns_)
+        {
+            return planStruct(data_, rowVector_, std::tuple<>{}, std::tuple{ columns_... });
+        }
+
+        //// phase 2: fill all data buffers of the outputs planned so far, in parallel. The plan can be reused
+        //// afterward
+        void execute()
+        {
+            // split tasks into blocks, the unit of work distribution
+            std::vector<std::pair<size_t, size_t>> blocks;   // task, first element
+            for (size_t t = 0; t < _tasks.size(); t++)
+                for (size_t b = 0; b < _tasks[t].n; b += _tasks[t].grain)
+                    blocks.emplace_back(t, b);
+            _pool.parallelFor(blocks.size(), [&](size_t i_)
+            {
+                const auto [t, b] = blocks[i_];
+                _tasks[t].fill(b, std::min(b + _tasks[t].grain, _tasks[t].n));
+            });
+            _tasks.clear();
+            _keepAlive.clear();
+        }
+
+        // number of fill tasks planned
+        size_t nTasks() const { return _tasks.size(); }
+
+    private:
+        struct Task
+        {
+            size_t                              n;      // number of elements to fill
+            size_t                              grain;  // elements per block
+            std::function<void(size_t, size_t)> fill;  // fill elements [first, last)
+        };
+
+        // fill_(i, item) for i in [first, last) will be invoked with item the i-th element of data_
+        template <typename Cont, typename F>
+        void addTask(const Cont& data_, size_t grain_, F&& fill_)
+        {
+            const size_t n = data_.size();
+            if (!n)
+                return;
+            _tasks.push_back({ n, detail::isRandomAccess_v<Cont> ? grain_ : n, [&data_, fill = std::forward<F>(fill_)](size_t first_, size_t last_)
+            {
+                auto it = std::next(std::cbegin(data_), first_);
+                for (size_t i = first_; i < last_; ++i, ++it)
+                    fill(i, *it);
+            } });
+        }
+
+        // f_(i, item) for each element of data_, on the workers when data_ is random access
+        template <typename Cont, typename F>
+        void forEachParallel(const Cont& data_, size_t grain_, F&& f_)
+        {
+            if constexpr (detail::isRandomAccess_v<Cont>)
+                _pool.parallelFor((data_.size() + grain_ - 1) / grain_, [&](size_t blk_)
+                {
+                    const size_t first = blk_ * grain_, last = std::min(first + grain_, data_.size());
+                    for (size_t i = first; i < last; i++)
+                        f_(i, data_[i]);
+                });
+            else
+            {
+                size_t i = 0;
+                for (auto&& item : data_)
+                    f_(i++, item);
+            }
+        }
+
+        std::pair<mwSize, mwSize> vectorDims(size_t n_, bool rowVector_) const
+        {
+            return rowVector_ ? std::pair<mwSize, mwSize>{ 1, static_cast<mwSize>(n_) } : std::pair<mwSize, mwSize>{ static_cast<mwSize>(n_), 1 };
+        }
+
+        mxArray* planString(const std::string& str_)
+        {
+            const auto s = detail::cStringView(str_);
+            const auto dims = detail::charDims(detail::utf16Length(s));
+            mxArray* out = mxCreateCharArray(2, dims.data());
+            detail::utf8ToUtf16(s, mxGetChars(out));   // NB: no need to defer a single string
+            return out;
+        }
+
+        template <typename T, typename... Extras>
+        mxArray* plan(const T& data_, Extras... extras_)
+        {
+            if constexpr (std::is_same_v<T, std::string> && sizeof...(Extras) == 0)
+                return planString(data_);
+            else if constexpr (Container<T> && !std::is_same_v<T, std::string> && detail::isPlannableTag_v<Extras...>)
+                return planContainer(data_, MEX_TYPE_UTILS_OUTPUT_ROWVECTORS, extras_...);
+            else
+                // scalars, layout tags and types the planner does not know about: convert directly
+                return mxTypes::ToMatlab(data_, extras_...);
+        }
+
+        template <typename Cont, typename... Extras>
+        mxArray* planContainer(const Cont& data_, const bool rowVector_, Extras... extras_)
+        {
+            using V = typename Cont::value_type;
+            const auto [rCount, cCount] = vectorDims(data_.size(), rowVector_);
+
+            if constexpr (Chrono<V>)
+            {
+                // encoding of the values, Ticks by default
+                using E   = std::tuple_element_t<0, std::tuple<Extras..., Ticks>>;
+                using Out = decltype(E{}(std::declval<V>()));
+                mxArray* out;
+                auto storage = static_cast<Out*>(mxGetData(out = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<Out>, mxREAL)));
+                addTask(data_, numericGrain, [storage](size_t i_, const V& v_) { storage[i_] = E{}(v_); });
+                return out;
+            }
+            else if constexpr (std::is_arithmetic_v<V>)
+            {
+                using outputType = std::tuple_element_t<0, std::tuple<Extras..., V>>;
+                mxArray* out;
+                auto storage = static_cast<outputType*>(mxGetData(out = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<outputType>, mxREAL)));
+                addTask(data_, numericGrain, [storage](size_t i_, const V& v_) { storage[i_] = static_cast<outputType>(v_); });
+                return out;
+            }
+            else if constexpr (std::is_same_v<V, std::string> && sizeof...(Extras) == 0)
+                return planStrings(data_, rowVector_, std::identity{});
+            else if constexpr (RaggedContainer<Cont> && sizeof...(Extras) == 0)
+                return planArrays(data_, rowVector_, std::identity{});
+            else if constexpr (typeNeedsMxCellStorage_v<V>)
+            {
+                // cell: plan each element
+                mxArray* out = mxCreateCellMatrix(rCount, cCount);
+                mwIndex i = 0;
+                for (auto&& item : data_)
+                    mxSetCell(out, i++, plan(item, extras_...));
+                return out;
+            }
+            else
+                return mxTypes::ToMatlab(data_, extras_...);
+        }
+
+        // cell of strings proj_(item) for each element of data_: measure the strings on the workers, create
+        // the char arrays, and transcode in the fill task
+        template <typename Cont, typename Proj>
+        mxArray* planStrings(const Cont& data_, const bool rowVector_, Proj proj_)
+        {
+            const auto [rCount, cCount] = vectorDims(data_.size(), rowVector_);
+            auto lengths = std::vector<size_t>(data_.size());
+            forEachParallel(data_, stringGrain, [&](size_t i_, const auto& item_) { lengths[i_] = detail::utf16Length(detail::cStringView(proj_(item_))); });
+            mxArray* out = mxCreateCellMatrix(rCount, cCount);
+            auto dest = std::make_shared<std::vector<mxChar*>>(data_.size());
+            for (size_t i = 0; i < data_.size(); i++)
+            {
+                const auto dims = detail::charDims(lengths[i]);
+                mxArray* str = mxCreateCharArray(2, dims.data());
+                (*dest)[i] = mxGetChars(str);
+                mxSetCell(out, static_cast<mwIndex>(i), str);
+            }
+            addTask(data_, stringGrain, [dest, proj_](size_t i_, const auto& item_) { detail::utf8ToUtf16(detail::cStringView(proj_(item_)), (*dest)[i_]); });
+            return out;
+        }
+        // cell of numeric arrays, one per container proj_(item) for each element of data_: create the arrays,
+        // fill them in a single task over data_
+        template <typename Cont, typename Proj>
+        mxArray* planArrays(const Cont& data_, const bool rowVector_, Proj proj_)
+        {
+            using W = typename std::remove_cvref_t<decltype(proj_(*std::cbegin(data_)))>::value_type;
+            const auto [rCount, cCount] = vectorDims(data_.size(), rowVector_);
+            mxArray* out = mxCreateCellMatrix(rCount, cCount);
+            auto dest = std::make_shared<std::vector<W*>>(data_.size());
+            size_t i = 0;
+            for (auto&& item : data_)
+            {
+                const auto [r, c] = vectorDims(proj_(item).size(), MEX_TYPE_UTILS_OUTPUT_ROWVECTORS);
+                mxArray* arr = mxCreateUninitNumericMatrix(r, c, typeToMxClass_v<W>, mxREAL);
+                (*dest)[i] = static_cast<W*>(mxGetData(arr));
+                mxSetCell(out, static_cast<mwIndex>(i++), arr);
+            }
+            addTask(data_, stringGrain, [dest, proj_](size_t i_, const auto& item_)
+            {
+                const auto& inner = proj_(item_);
+                std::copy(std::cbegin(inner), std::cend(inner), (*dest)[i_]);
+            });
+            return out;
+        }
+
+        template <typename Cont, typename Path, typename Children>
+        mxArray* planStruct(const Cont& data_, const bool rowVector_, const Path& path_, const Children& children_)
+        {
+            return std::apply([&](const auto&... child_)
+            {
+                static_assert(sizeof...(child_) > 0, "A nested struct must have at least one field");
+                const char* fieldNames[] = { child_.name... };
+                mxArray* out = mxCreateStructMatrix(1, 1, static_cast<int>(sizeof...(child_)), fieldNames);
+                int f = 0;
+                auto planChild = [&]<typename C>(const C& c_)
+                {
+                    mxArray* arr;
+                    if constexpr (is_specialization_v<C, NamedColumn>)
+                        arr = std::apply([&](auto... fields_) { return FieldToMatlab(data_, rowVector_, fields_...); }, std::tuple_cat(path_, c_.fields));
+                    else
+                        arr = planStruct(data_, rowVector_, std::tuple_cat(path_, c_.path), c_.children);
+                    mxSetFieldByNumber(out, 0, f++, arr);
+                };
+                (planChild(child_), ...);
+                return out;
+            }, children_);
+        }
+
+        worker_pool::Pool&                  _pool;
+        std::vector<Task>                   _tasks;
+        std::vector<std::shared_ptr<void>>  _keepAlive;     // converted values that tasks read from
+    };
+
+    template <typename Cont, typename... Fs>
+    requires Container<Cont>
+    mxArray* ConversionPlan::FieldToMatlab(const Cont& data_, const bool rowVector_, Fs... fields_)
+    {
+        using V = typename Cont::value_type;
+        using U = std::decay_t<decltype(nested_field::getWrapper(std::declval<V>(), fields_...))>;
+        constexpr bool isMemberPath = (std::is_member_object_pointer_v<Fs> && ...);
+        const auto [rCount, cCount] = vectorDims(data_.size(), rowVector_);
+
+        if constexpr (HasFieldSchema<U> && isMemberPath)
+            // field is a struct with a registered schema: output nested struct of arrays
+            return planStruct(data_, rowVector_, std::make_tuple(fields_...), fieldSchema<U>::value);
+        else if constexpr (Chrono<U>)
+            // std::chrono field without encoding: default encoding
+            return FieldToMatlab(data_, rowVector_, fields_..., Ticks{});
+        else if constexpr (std::is_same_v<U, std::string> && isMemberPath)
+            return planStrings(data_, rowVector_, [fields_...](const V& item_) -> const std::string& { return *detail::fieldAddress(item_, fields_...); });
+        else if constexpr (RaggedContainer<std::vector<U>> && isMemberPath)
+            return planArrays(data_, rowVector_, [fields_...](const V& item_) -> const U& { return *detail::fieldAddress(item_, fields_...); });
+        else if constexpr (typeNeedsMxCellStorage_v<U> && isMemberPath)
+        {
+            // cell: plan the members in place
+            mxArray* out = mxCreateCellMatrix(rCount, cCount);
+            mwIndex i = 0;
+            for (auto&& item : data_)
+                mxSetCell(out, i++, plan(*detail::fieldAddress(item, fields_...)));
+            return out;
+        }
+        else if constexpr (typeNeedsMxCellStorage_v<U> && std::is_default_constructible_v<U>)
+        {
+            // cell of converted values: run the conversion on the workers, keep the values for the fill tasks
+            auto values = std::make_shared<std::vector<U>>(data_.size());
+            forEachParallel(data_, stringGrain, [&](size_t i_, const V& item_) { (*values)[i_] = nested_field::getWrapper(item_, fields_...); });
+            _keepAlive.push_back(values);
+            return planContainer(*values, rowVector_);
+        }
+        else if constexpr (typeNeedsMxCellStorage_v<U>)
+            return mxTypes::FieldToMatlab(data_, rowVector_, fields_...);
+        else
+        {
+            static_assert(typeToMxClass_v<U> != mxSTRUCT_CLASS, "To export a field of struct type, register a fieldSchema for it (or use FieldsToMatlab() with Nested())");
+            mxArray* out;
+            auto storage = static_cast<U*>(mxGetData(out = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<U>, mxREAL)));
+            if constexpr (ContiguousStorage<Cont> && detail::isStridedField<V, Fs...>())
+            {
+                // plain member variable: gather blocks straight from the objects' storage
+                if (!data_.empty())
+                {
+                    const auto field = detail::fieldAddress(*std::cbegin(data_), fields_...);
+                    using In = std::remove_cvref_t<decltype(*field)>;
+                    const auto base = reinterpret_cast<const std::byte*>(field);
+                    _tasks.push_back({ data_.size(), numericGrain, [base, storage](size_t first_, size_t last_)
+                    {
+                        strided_gather::gather<In>(base + first_ * sizeof(V), sizeof(V), last_ - first_, storage + first_);
+                    } });
+                }
+            }
+            else if constexpr (ContiguousStorage<Cont> && detail::isStridedChronoField<V, Fs...>())
+            {
+                // std::chrono member variable: gather and encode blocks of tick counts
+                if (!data_.empty())
+                {
+                    const auto field = detail::fieldAddress(*std::cbegin(data_), fields_...);
+                    using T = std::remove_cvref_t<decltype(*field)>;
+                    const auto base = reinterpret_cast<const std::byte*>(field);
+                    _tasks.push_back({ data_.size(), numericGrain, [base, storage](size_t first_, size_t last_)
+                    {
+                        detail::gatherEncodeTicks<T, last<0, Fs...>>(base + first_ * sizeof(V), sizeof(V), last_ - first_, storage + first_);
+                    } });
+                }
+            }
+            else
+                addTask(data_, numericGrain, [storage, fields_...](size_t i_, const V& item_) { storage[i_] = nested_field::getWrapper(item_, fields_...); });
+            return out;
+        }
+    }
+}
@@ -0,0 +1,225 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "mex_type_utils.h"
+#include "mex_input_getter.h"
+#include "mex_latency.h"
+#include "mex_output_writer.h"
+#include "mex_arena.h"
+#include "invocable_traits.h"
+#include "fixed_string.h"
+#include "perfect_hash.h"
+#include "is_specialization_trait.h"
+
+// Dispatches a mex call to one of a set of named commands. The first input argument of the mex call
+// is the command name, the remaining input arguments are converted to the argument types of the
+// command's callable (deduced with invocable_traits::get, so overloaded/templated callables are not
+// supported) using FromMatlab (see ParseArgs). The callable's return value is converted using
+// ToMatlab. If the callable returns a std::tuple, each element is returned as a separate output
+// argument (only those requested by the caller are converted, elements can be Lazy() thunks that are
+// only invoked when requested, see mex_output_writer.h). Example:
+//
+// static const auto dispatcher = mxTypes::Dispatcher(
+//     mxTypes::Cmd<"init">(&init),
+//     mxTypes::Cmd<"getData">([](std::optional<int32_t> n_) { return getData(n_); }));
+// void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+// {
+//     try { dispatcher(nlhs, plhs, nrhs, prhs); }
+//     catch (const std::string& e) { mexErrMsgTxt(e.c_str()); }
+// }
+//
+// Command names must be valid MATLAB identifiers (checked at compile time), and are looked up through
+// a perfect hash table built at compile time. Each call is an ArenaScope, so scratch memory (see
+// mex_arena.h) is reset after each call.
+//
+// Per-command latency histograms, split into time spent parsing arguments, in the command itself
+// and converting the outputs, can be recorded by calling recordLatencies(true), and retrieved as a
+// MATLAB struct (one field per command) through latencyStats().
+namespace mxTypes
+{
+    template <fixed_string Name, typename F>
+    struct Command
+    {
+        static constexpr std::string_view name = Name;
+        // names are struct field names in latencyStats()
+        static_assert(detail::isMatlabIdentifier(name), "Command names must be valid MATLAB identifiers (a letter followed by letters, digits and underscores, at most 63 characters).");
+        F func;
+    };
+
+    template <fixed_string Name, typename F>
+    constexpr Command<Name, std::decay_t<F>> Cmd(F&& func_)
+    {
+        return { std::forward<F>(func_) };
+    }
+
+    namespace detail
+    {
+        // parse input arguments into the (decayed) argument types of callable F
+        template <typename F, typename = std::make_index_sequence<invocable_traits::get<F>::arity>>
+        struct argParser;
+        template <typename F, size_t... Is>
+        struct argParser<F, std::index_sequence<Is...>>
+        {
+            static auto parse(int nrhs, const mxArray* prhs[], std::string_view funcID_)
+            {
+                return ParseArgs<std::decay_t<typename invocable_traits::get<F>::template arg_t<Is>>...>(nrhs, prhs, funcID_, 1);
+            }
+        };
+
+        inline void throwDispatchError(std::string_view funcID_, std::string_view msg_)
+        {
+            std::string out = "SWAG::";
+            if (!funcID_.empty())
+            {
+                out += funcID_;
+                out += ": ";
+            }
+            out += msg_;
+            throw out;
+        }
+
+        // number of outputs of a command returning R: none for void, one per element of a std::tuple, else one
+        template <typename R>
+        constexpr int nCommandOutputs()
+        {
+            if constexpr (std::is_void_v<R>)
+                return 0;
+            else if constexpr (is_specialization_v<R, std::tuple>)
+                return static_cast<int>(std::tuple_size_v<R>);
+            else
+                return 1;
+        }
+        inline void throwTooManyOutputs(std::string_view funcID_, int nOut_)
+        {
+            if (nOut_ == 0)
+                throwDispatchError(funcID_, "Too many output arguments. This command has no outputs.");
+            throwDispatchError(funcID_, "Too many output arguments. At most " + std::to_string(nOut_) + (nOut_ == 1 ? " is" : " are") + " provided.");
+        }
+
+        // NB: the number of requested outputs has been checked already, see Dispatcher::invoke
+        template <typename R>
+        void marshalOutputs(std::string_view funcID_, int nlhs, mxArray* plhs[], R&& result_)
+        {
+            if constexpr (is_specialization_v<R, std::tuple>)
+                // only convert requested outputs (but always the first, it goes into ans)
+                std::apply([&](auto&&... outs_) { OutputWriter(nlhs, plhs, funcID_)(std::forward<decltype(outs_)>(outs_)...); }, std::move(result_));
+            else
+                plhs[0] = toOutput(std::move(result_));
+        }
+    }
+
+    template <typename... Commands>
+    class Dispatcher
+    {
+    public:
+        static constexpr size_t nCommand = sizeof...(Commands);
+
+        constexpr Dispatcher(Commands... commands_) : _commands(std::move(commands_)...) {}
+
+        // prhs[0] should contain the command name
+        void operator()(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) const
+        {
+            ArenaScope scratchScope;
+            const auto idx = lookup(nrhs, prhs);
+            _invokers[idx](*this, nlhs, plhs, nrhs, prhs);
+        }
+
+        // returns index of the command whose name is in prhs[0]. Throws if not a known command
+        size_t lookup(int nrhs, const mxArray* prhs[]) const
+        {
+            if (nrhs < 1 || !mxIsChar(prhs[0]))
+                detail::throwDispatchError("", "First input argument must be a command (string).");
+
+            // command names are short, copy into buffer on the stack. A name that doesn't fit (mxGetString
+            // returns non-zero when truncating) can't be a known command
+            char buf[_maxNameLength + 2];
+            const auto truncated = mxGetString(prhs[0], buf, sizeof(buf));
+            const std::string_view name{ buf };
+            const auto idx = truncated ? _table.npos : _table.find(name);
+            if (idx == _table.npos)
+                detail::throwDispatchError("", "Unrecognized command: " + std::string(name) + (truncated ? "..." : ""));
+            return idx;
+        }
+
+        static constexpr std::string_view name(size_t idx_) { return _names[idx_]; }
+
+        // latency instrumentation, off by default
+        void recordLatencies(bool on_) const { _recordLatencies.store(on_, std::memory_order_relaxed); }
+        void resetLatencies() const
+        {
+            for (auto& l : _latencies)
+                l.reset();
+        }
+        const CommandLatencies& latencies(size_t idx_) const { return _latencies[idx_]; }
+        // struct with a field per command, see ToMatlab(const CommandLatencies&)
+        mxArray* latencyStats() const
+        {
+            std::array<const char*, nCommand> fieldNames;
+            for (size_t i = 0; i < nCommand; i++)
+                fieldNames[i] = _names[i].data();   // NB: fixed_string storage is null-terminated, names are valid identifiers (see Command)
+            mxArray* out = mxCreateStructMatrix(1, 1, static_cast<int>(nCommand), fieldNames.data());
+            for (size_t i = 0; i < nCommand; i++)
+                mxSetFieldByNumber(out, 0, static_cast<int>(i), ToMatlab(_latencies[i]));
+            return out;
+        }
+
+    private:
+        template <size_t I>
+        static void invoke(const Dispatcher& self_, int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+        {
+            using Cmd    = std::tuple_element_t<I, std::tuple<Commands...>>;
+            using F      = decltype(Cmd::func);
+            using traits = invocable_traits::get<F>;
+            invocable_traits::issue_error<traits::error>();
+            static_assert(traits::error != invocable_traits::Error::None || std::is_void_v<typename traits::class_t> || std::is_class_v<F>, "Commands must be free functions or function objects, not member function pointers.");
+            static_assert(traits::error != invocable_traits::Error::None || !traits::is_variadic, "Commands cannot be variadic.");
+
+            // check the number of requested outputs before the command runs, so that a call that can't succeed
+            // has no side effects
+            using R = std::decay_t<typename traits::invoke_result_t>;
+            if (nlhs > detail::nCommandOutputs<R>())
+                detail::throwTooManyOutputs(Cmd::name, detail::nCommandOutputs<R>());
+
+            PhaseTimer timer(self_._recordLatencies.load(std::memory_order_relaxed) ? &self_._latencies[I] : nullptr);
+            const auto& func = std::get<I>(self_._commands).func;
+            auto args = detail::argParser<F>::parse(nrhs, prhs, Cmd::name);
+            timer.lap(Phase::Parse);
+
+            if constexpr (std::is_void_v<R>)
+            {
+                std::apply(func, std::move(args));
+                timer.lap(Phase::Handler);
+                timer.lap(Phase::Marshal);
+            }
+            else
+            {
+                auto result = std::apply(func, std::move(args));
+                timer.lap(Phase::Handler);
+                detail::marshalOutputs(Cmd::name, nlhs, plhs, std::move(result));
+                timer.lap(Phase::Marshal);
+            }
+        }
+
+        using Invoker = void(*)(const Dispatcher&, int, mxArray*[], int, const mxArray*[]);
+        static constexpr std::array<Invoker, nCommand> _invokers = []<size_t... Is>(std::index_sequence<Is...>)
+        {
+            return std::array<Invoker, nCommand>{ &invoke<Is>... };
+        }(std::index_sequence_for<Commands...>{});
+
+        static constexpr std::array<std::string_view, nCommand> _names = { Commands::name... };
+        static constexpr auto   _table = perfect_hash::make_table<nCommand>(_names);
+        static constexpr size_t _maxNameLength = std::max({ size_t{0}, Commands::name.size()... });
+
+        std::tuple<Commands...> _commands;
+
+        mutable std::atomic<bool> _recordLatencies{ false };
+        mutable std::array<CommandLatencies, nCommand> _latencies{};
+    };
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "perfect_hash.h"
+
+namespace mxTypes {
+    // register an enum for conversion to and from MATLAB strings by specializing enumNames with a
+    // constexpr table of (value, name) pairs. Names must be string literals (null-terminated). E.g.:
+    // namespace mxTypes {
+    //     template <>
+    //     struct enumNames<EventType>
+    //     {
+    //         static constexpr std::array value = {
+    //             std::pair{EventType::Fixation, std::string_view{"fixation"}},
+    //             std::pair{EventType::Saccade,  std::string_view{"saccade"}}
+    //         };
+    //     };
+    // }
+    template <typename E>
+    struct enumNames;
+
+    template <typename E>
+    concept RegisteredEnum = std::is_enum_v<E> && requires { enumNames<E>::value; };
+
+    namespace detail
+    {
+        // lookup tables for a registered enum, built at compile time
+        template <RegisteredEnum E>
+        struct enumInfo
+        {
+            using U = std::underlying_type_t<E>;
+            static constexpr auto&  table = enumNames<E>::value;
+            static constexpr size_t N     = table.size();
+            static constexpr size_t npos  = N;
+
+            static constexpr std::array<std::string_view, N> names = []
+            {
+                std::array<std::string_view, N> out{};
+                for (size_t i = 0; i < N; i++)
+                    out[i] = table[i].second;
+                return out;
+            }();
+            static constexpr size_t maxNameLength = []
+            {
+                size_t out = 0;
+                for (auto&& n : names)
+                    out = n.size() > out ? n.size() : out;
+                return out;
+            }();
+
+            // string -> index, through perfect hash
+            static constexpr auto nameTable = perfect_hash::make_table<N>(names);
+
+            // value -> index, through a lookup table if the values span a small range, else by scanning the table
+            static constexpr U minValue = [] { U m = N ? static_cast<U>(table[0].first) : U{}; for (auto&& [v, n] : table) m = static_cast<U>(v) < m ? static_cast<U>(v) : m; return m; }();
+            static constexpr U maxValue = [] { U m = N ? static_cast<U>(table[0].first) : U{}; for (auto&& [v, n] : table) m = static_cast<U>(v) > m ? static_cast<U>(v) : m; return m; }();
+            static constexpr bool   useLut   = N && static_cast<uint64_t>(maxValue) - static_cast<uint64_t>(minValue) < 1024;
+            static constexpr size_t lutSize  = useLut ? static_cast<size_t>(static_cast<uint64_t>(maxValue) - static_cast<uint64_t>(minValue)) + 1 : 0;
+            static constexpr std::array<size_t, lutSize> lut = []
+            {
+                std::array<size_t, lutSize> out{};
+                out.fill(npos);
+                for (size_t i = lutSize ? N : 0; i-- > 0;)   // backward, so that first name wins for duplicate values
+                    out[static_cast<size_t>(static_cast<U>(table[i].first) - minValue)] = i;
+                return out;
+            }();
+
+            static constexpr size_t indexOf(E val_)
+            {
+                if constexpr (useLut)
+                {
+                    const auto v = static_cast<U>(val_);
+                    return v < minValue || v > maxValue ? npos : lut[static_cast<size_t>(v - minValue)];
+                }
+                else
+                {
+                    for (size_t i = 0; i < N; i++)
+                        if (table[i].first == val_)
+                            return i;
+                    return npos;
+                }
+            }
+            static constexpr size_t indexOf(std::string_view name_)
+            {
+                return nameTable.find(name_);
+            }
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+
+#include "mex_type_utils.h"
+
+// incremental export of a container that is being appended to (e.g. a sample buffer that a MATLAB loop
+// polls every frame): a cursor remembers how far the container has been exported, and each call exports
+// only the elements appended since the previous call, so the cost of a call is proportional to the new
+// data, not to the size of the container.
+//
+// std::vector<Sample> buffer;      // filled elsewhere
+// mxTypes::ExportCursor cursor(buffer, false, Column("ts", &Sample::ts), Column("x", &Sample::gaze, &Gaze::x));
+// ...
+// plhs[0] = cursor.next();         // struct of arrays with the new samples (see FieldsToMatlab)
+//
+// Without columns, the container's elements are exported directly (as by ToMatlab()).
+// The cursor refers to the container, which must outlive it. If the owner of the container removes
+// elements from its front (e.g. to bound its size), it should tell the cursor through dropFront(), so
+// that the cursor's position keeps pointing to the same element. Other removals can't reliably be
+// detected from the container's size (e.g. clearing it and appending as many elements as before
+// between two calls), so the owner should count them in a generation counter that the cursor watches
+// (see watchGeneration()), or call reset(). Lacking either, a container found to be shorter than the
+// cursor's position is assumed to have been cleared, and the cursor restarts at its beginning.
+namespace mxTypes
+{
+    template <typename Cont, typename... Cols>
+    requires Container<Cont> && std::random_access_iterator<typename Cont::const_iterator>
+    class ExportCursor
+    {
+    public:
+        ExportCursor(const Cont& data_, const bool rowVector_, Cols... columns_) :
+            _data(&data_), _rowVector(rowVector_), _columns(columns_...) {}
+
+        // export the elements appended since the previous call (all elements on the first call)
+        mxArray* next()
+        {
+            if (generationChanged() || _data->size() < _pos)
+                _pos = 0;   // container was truncated
+            if (_generation)
+                _seenGeneration = *_generation;
+            const IndexRange range{ _pos, _data->size() };
+            mxArray* out;
+            if constexpr (sizeof...(Cols) == 0)
+            {
+                out = ToMatlab(*_data, range);
+                if (_rowVector != MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+                {
+                    // output is a vector, transposing is just swapping its dimensions
+                    const auto m = mxGetM(out);
+                    mxSetM(out, mxGetN(out));
+                    mxSetN(out, m);
+                }
+            }
+            else
+                out = std::apply([&](const auto&... cols_) { return FieldsToMatlab(*_data, range, _rowVector, cols_...); }, _columns);
+            _pos = range.last;
+            return out;
+        }
+
+        // number of elements that the next call to next() will export
+        size_t pending() const
+        {
+            return generationChanged() || _data->size() < _pos ? _data->size() : _data->size() - _pos;
+        }
+        // index of the first element that has not been exported yet
+        size_t position() const { return _pos; }
+        // make the next call to next() start at element pos_ (e.g., 0 to export everything again)
+        void reset(size_t pos_ = 0) { _pos = pos_; }
+        // n_ elements were removed from the front of the container
+        void dropFront(size_t n_) { _pos -= std::min(n_, _pos); }
+        // restart at the beginning of the container whenever generation_ has changed since the previous
+        // call to next(). The container's owner increments it when removing or replacing elements other
+        // than through dropFront(). generation_ must outlive the cursor
+        void watchGeneration(const uint64_t& generation_)
+        {
+            _generation     = &generation_;
+            _seenGeneration = generation_;
+        }
+
+    private:
+        bool generationChanged() const { return _generation && *_generation != _seenGeneration; }
+
+
+        const Cont*         _data;
+        size_t              _pos = 0;
+        bool                _rowVector;
+        std::tuple<Cols...> _columns;
+        const uint64_t*     _generation     = nullptr;
+        uint64_t            _seenGeneration = 0;
+    };
+}
@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "mex_type_utils.h"
+#include "always_false.h"
+#include "get_field_nested.h"
+#include "strided_gather.h"
+
+// Export of data too large to (comfortably) hold in MATLAB memory: instead of creating MATLAB arrays,
+// the data is streamed into a raw binary file, and a small MATLAB struct describing the file's layout is
+// returned. The file can then be opened with MATLAB's memmapfile, so that only the parts actually
+// accessed are paged in:
+// s = myMex('export', 'recording.bin');
+// m = memmapfile(s.filename, 'Format', s.format, 'Offset', s.offset, 'Repeat', s.repeat);
+// x = m.Data.x(1:1000);
+//
+// The file contains one column per exported field, stored one after the other. ToFile() exports a
+// container of arithmetic values as a single column, FieldsToFile() exports a struct-of-arrays (like
+// FieldToMatlab, one column per Column() (see mex_type_utils_fwd.h), using the same field specifications). Since memmapfile does
+// not support logical data, bools are stored as uint8. Other columns must be double, float or fixed-width
+// integers (use a type tag to convert e.g. chars), and column names must be valid MATLAB identifiers.
+//
+// The returned struct has the fields:
+// filename: the file written
+// offset  : byte offset of the first column in the file (always 0)
+// format  : Nx3 cell array with for each column its class, dimensions and name, as accepted by memmapfile
+// repeat  : 1
+// columns : struct array with for each column its name, class, dims and byte offset into the file,
+//           for use with e.g. fseek()+fread()
+namespace mxTypes
+{
+    namespace detail
+    {
+        // memmapfile can't do logicals, store as uint8
+        template <typename T>
+        using fileStorage_t = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+        // class name as understood by memmapfile
+        template <typename T>
+        constexpr const char* fileClassName()
+        {
+            using S = fileStorage_t<T>;
+            if constexpr (std::is_same_v<S, double>)
+                return "double";
+            else if constexpr (std::is_same_v<S, float>)
+                return "single";
+            else if constexpr (std::is_same_v<S, int8_t>)
+                return "int8";
+            else if constexpr (std::is_same_v<S, uint8_t>)
+                return "uint8";
+            else if constexpr (std::is_same_v<S, int16_t>)
+                return "int16";
+            else if constexpr (std::is_same_v<S, uint16_t>)
+                return "uint16";
+            else if constexpr (std::is_same_v<S, int32_t>)
+                return "int32";
+            else if constexpr (std::is_same_v<S, uint32_t>)
+                return "uint32";
+            else if constexpr (std::is_same_v<S, int64_t>)
+                return "int64";
+            else if constexpr (std::is_same_v<S, uint64_t>)
+                return "uint64";
+            else
+            {
+                // e.g. char: memmapfile has no character format
+                static_assert(always_false_t<T>, "export to file: column type not supported by memmapfile, use a type tag to convert it to a numeric type");
+                return "";
+            }
+        }
+        // column names become struct field names of the memmapfile's Data
+        inline void checkColumnName(const char* name_, std::string_view funcID_)
+        {
+            if (!isMatlabIdentifier(name_))
+                throw "SWAG::" + std::string(funcID_) + ": Column name \"" + name_ + "\" is not a valid MATLAB identifier.";
+        }
+
+        class FileWriter
+        {
+        public:
+            static constexpr size_t bufferSize = size_t{ 1 } << 20;
+
+            FileWriter(const std::string& filename_, std::string_view funcID_) : _filename(filename_), _funcID(funcID_)
+            {
+                _file = std::fopen(filename_.c_str(), "wb");
+                if (!_file)
+                    throw "SWAG::" + _funcID + ": Cannot open file \"" + filename_ + "\" for writing.";
+                _buffer = std::make_unique<char[]>(bufferSize);
+                std::setvbuf(_file, _buffer.get(), _IOFBF, bufferSize);
+            }
+            ~FileWriter()
+            {
+                if (_file)
+                    std::fclose(_file);
+            }
+            FileWriter(const FileWriter&) = delete;
+            FileWriter& operator=(const FileWriter&) = delete;
+
+            void write(const void* data_, size_t nByte_)
+            {
+                if (nByte_ && std::fwrite(data_, 1, nByte_, _file) != nByte_)
+                    throw "SWAG::" + _funcID + ": Error writing to file \"" + _filename + "\" (disk full?).";
+                _position += nByte_;
+            }
+            void close()
+            {
+                const bool ok = std::fclose(_file) == 0;
+                _file = nullptr;
+                if (!ok)
+                    throw "SWAG::" + _funcID + ": Error writing to file \"" + _filename + "\" (disk full?).";
+            }
+            uint64_t position() const { return _position; }
+
+        private:
+            std::string             _filename;
+            std::string             _funcID;
+            std::FILE*              _file = nullptr;
+            std::unique_ptr<char[]> _buffer;
+            uint64_t                _position = 0;
+        };
+
+        // write one column, converting elements in chunks
+        template <typename T, typename Cont, typename Get>
+        void writeColumn(FileWriter& file_, const Cont& data_, Get&& get_)
+        {
+            using S = fileStorage_t<T>;
+            constexpr size_t chunkSize = 8192;
+            S chunk[chunkSize];
+            size_t n = 0;
+            for (auto&& item : data_)
+            {
+                chunk[n++] = static_cast<S>(get_(item));
+                if (n == chunkSize)
+                {
+                    file_.write(chunk, sizeof(chunk));
+                    n = 0;
+                }
+            }
+            file_.write(chunk, n * sizeof(S));
+        }
+
+        // write one column of a plain member variable at the given address in the first of nElem_ contiguous
+        // objects of size stride_, gathering elements in chunks (see strided_gather.h)
+        template <typename T, typename In>
+        void writeColumnStrided(FileWriter& file_, const In* field_, size_t stride_, size_t nElem_)
+        {
+            using S = fileStorage_t<T>;
+            // a bool column stored as uint8 must hold 0 or 1, not the truncated source value
+            static_assert(!std::is_same_v<T, bool> || std::is_same_v<In, bool>, "writeColumnStrided: cast to bool is not fused");
+            constexpr size_t chunkSize = 8192;
+            S chunk[chunkSize];
+            auto base = reinterpret_cast<const std::byte*>(field_);
+            for (size_t i = 0; i < nElem_; i += chunkSize, base += chunkSize * stride_)
+            {
+                const size_t n = std::min(chunkSize, nElem_ - i);
+                strided_gather::gather<In>(base, stride_, n, chunk);
+                file_.write(chunk, n * sizeof(S));
+            }
+        }
+
+        struct FileColumnInfo
+        {
+            const char* name;
+            const char* className;
+            uint64_t    offset;
+        };
+
+        inline mxArray* fileLayoutToMatlab(const std::string& filename_, std::span<const FileColumnInfo> columns_, mwSize nElem_, bool rowVector_)
+        {
+            const auto nCol = static_cast<mwSize>(columns_.size());
+            auto makeDims = [&]
+            {
+                mxArray* dims = mxCreateDoubleMatrix(1, 2, mxREAL);
+                auto d = static_cast<double*>(mxGetData(dims));
+                d[0] = static_cast<double>(rowVector_ ? 1 : nElem_);
+                d[1] = static_cast<double>(rowVector_ ? nElem_ : 1);
+                return dims;
+            };
+
+            mxArray* format = mxCreateCellMatrix(nCol, 3);
+            const char* colFieldNames[] = { "name", "class", "dims", "offset" };
+            mxArray* cols = mxCreateStructMatrix(nCol, 1, 4, colFieldNames);
+            for (mwIndex c = 0; c < nCol; c++)
+            {
+                mxSetCell(format, c,            mxCreateString(columns_[c].className));
+                mxSetCell(format, c + nCol,     makeDims());
+                mxSetCell(format, c + 2 * nCol, mxCreateString(columns_[c].name));
+
+                mxSetFieldByNumber(cols, c, 0, mxCreateString(columns_[c].name));
+                mxSetFieldByNumber(cols, c, 1, mxCreateString(columns_[c].className));
+                mxSetFieldByNumber(cols, c, 2, makeDims());
+                mxSetFieldByNumber(cols, c, 3, ToMatlab(columns_[c].offset));
+            }
+
+            const char* fieldNames[] = { "filename", "offset", "format", "repeat", "columns" };
+            mxArray* out = mxCreateStructMatrix(1, 1, 5, fieldNames);
+            mxSetFieldByNumber(out, 0, 0, mxCreateString(filename_.c_str()));
+            mxSetFieldByNumber(out, 0, 1, mxCreateDoubleScalar(0.));
+            mxSetFieldByNumber(out, 0, 2, format);
+            mxSetFieldByNumber(out, 0, 3, mxCreateDoubleScalar(1.));
+            mxSetFieldByNumber(out, 0, 4, cols);
+            return out;
+        }
+    }
+
+    // export a container of arithmetic values as a single column with the given name
+    template <typename Cont>
+    requires Container<Cont> && std::is_arithmetic_v<typename Cont::value_type>
+    mxArray* ToFile(const std::string& filename_, const Cont& data_, const char* name_ = "data", const bool rowVector_ = MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+    {
+        using V = typename Cont::value_type;
+        using S = detail::fileStorage_t<V>;
+        detail::checkColumnName(name_, "ToFile");
+        detail::FileWriter file(filename_, "ToFile");
+        if constexpr (ContiguousStorage<Cont> && std::is_same_v<V, S>)
+            file.write(data_.data(), data_.size() * sizeof(V));
+        else
+            detail::writeColumn<V>(file, data_, [](const V& v_) { return v_; });
+        file.close();
+        const detail::FileColumnInfo info{ name_, detail::fileClassName<V>(), 0 };
+        return detail::fileLayoutToMatlab(filename_, { &info, 1 }, static_cast<mwSize>(data_.size()), rowVector_);
+    }
+
+    // export a container of objects as a struct of arrays: one column per provided Column(name, fields...),
+    // where fields... are as for FieldToMatlab (pointers to (nested) member variables, optionally
+    // followed by a type tag or a conversion function). Each column must be of arithmetic type
+    template <typename Cont, typename... Cols>
+    requires Container<Cont> && (sizeof...(Cols) > 0)
+    mxArray* FieldsToFile(const std::string& filename_, const Cont& data_, const bool rowVector_, Cols... columns_)
+    {
+        using V = typename Cont::value_type;
+        (detail::checkColumnName(columns_.name, "FieldsToFile"), ...);
+        detail::FileWriter file(filename_, "FieldsToFile");
+        ArenaScope scratchScope;
+        std::pmr::vector<detail::FileColumnInfo> info(Scratch());
+        info.reserve(sizeof...(Cols));
+
+        auto writeOne = [&](const auto& col_)
+        {
+            std::apply([&](auto... fields_)
+            {
+                using U = std::decay_t<decltype(nested_field::getWrapper(std::declval<V>(), fields_...))>;
+                static_assert(std::is_arithmetic_v<U>, "FieldsToFile: only columns of arithmetic type can be exported to file");
+                info.push_back({ col_.name, detail::fileClassName<U>(), file.position() });
+                if constexpr (ContiguousStorage<Cont> && detail::isStridedField<V, decltype(fields_)...>() &&
+                              (!std::is_same_v<U, bool> || (std::is_member_object_pointer_v<decltype(fields_)> && ...)))
+                {
+                    if (!data_.empty())
+                        detail::writeColumnStrided<U>(file, detail::fieldAddress(*std::cbegin(data_), fields_...), sizeof(V), data_.size());
+                }
+                else
+                    detail::writeColumn<U>(file, data_, [&](const V& item_) { return nested_field::getWrapper(item_, fields_...); });
+            }, col_.fields);
+        };
+        (writeOne(columns_), ...);
+        file.close();
+        return detail::fileLayoutToMatlab(filename_, info, static_cast<mwSize>(data_.size()), rowVector_);
+    }
+}
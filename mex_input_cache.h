@@ -0,0 +1,316 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+
+#include "mex_type_utils.h"
+#include "mex_input_getter.h"
+
+// memoised FromMatlab, for large inputs that are passed unchanged on every call (configuration structs,
+// lookup tables, etc). Parsing such an input again on every call is wasted work, instead the parsed
+// object is kept and returned as long as the input does not change:
+//
+// void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+// {
+//     auto config = mxTypes::CachedFromMatlab<Config>(nrhs, prhs, 1, "myMex", 1);  // std::shared_ptr<const Config>
+//     ...
+// }
+//
+// Arguments are as for FromMatlab. Entries are keyed on the identity of the input (its mxArray*) and
+// the requested type, and are only reused if a fingerprint of the input's content matches that of the
+// input the entry was parsed from. The fingerprint is a 64-bit hash of the input's class, dimensions
+// and data (vectorised with AVX2), recursing into cells and structs (including field names), so
+// checking an entry costs a single pass over the input's memory. Sparse and complex inputs, and classes
+// other than numeric, logical, char, cell and struct, are not cached (FromMatlab is called as usual).
+//
+// The cache has a memory budget (the size of an entry is estimated as the size of the input's data plus
+// sizeof(T)), least recently used entries are evicted when it is exceeded. Returned objects remain valid
+// after eviction. A std::optional<T> output type yields a nullptr if the argument is not provided. The
+// cache is not thread-safe, use it from the mex thread only.
+namespace mxTypes
+{
+    namespace detail
+    {
+        inline constexpr uint64_t fmix64(uint64_t h_)
+        {
+            h_ ^= h_ >> 33;
+            h_ *= 0xff51afd7ed558ccdULL;
+            h_ ^= h_ >> 33;
+            h_ *= 0xc4ceb9fe1a85ec53ULL;
+            h_ ^= h_ >> 33;
+            return h_;
+        }
+        inline constexpr uint64_t hashCombine(uint64_t h_, uint64_t v_)
+        {
+            return fmix64(h_ ^ (v_ + 0x9e3779b97f4a7c15ULL + (h_ << 6) + (h_ >> 2)));
+        }
+
+        // hash of a block of memory. Processes 32-byte stripes into four 64-bit lanes, each lane:
+        // acc += v + lo32(k)*hi32(k), with k = v ^ key, and a key that changes per stripe so that the
+        // hash depends on the order of the stripes. The scalar and AVX2 paths compute the same hash
+        struct hashKeys
+        {
+            static constexpr uint64_t lane[4] = { 0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL };
+            static constexpr uint64_t step    = 0x9e3779b97f4a7c15ULL;
+        };
+        inline uint64_t hashBytes(const void* data_, size_t n_)
+        {
+            const auto* p   = static_cast<const std::byte*>(data_);
+            const size_t nStripe = n_ / 32;
+            uint64_t acc[4] = { n_, ~n_, n_ * hashKeys::step, 0 };
+            size_t s = 0;
+#if defined(__AVX2__)
+            {
+                __m256i vAcc  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+                __m256i vKey  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hashKeys::lane));
+                const __m256i vStep = _mm256_set1_epi64x(static_cast<long long>(hashKeys::step));
+                for (; s < nStripe; s++)
+                {
+                    const __m256i v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + s * 32));
+                    const __m256i k  = _mm256_xor_si256(v, vKey);
+                    const __m256i lh = _mm256_mul_epu32(k, _mm256_srli_epi64(k, 32));
+                    vAcc = _mm256_add_epi64(vAcc, _mm256_add_epi64(v, lh));
+                    vKey = _mm256_add_epi64(vKey, vStep);
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), vAcc);
+            }
+#endif
+            auto stripe = [&acc](const std::byte* p_, size_t s_)
+            {
+                for (size_t j = 0; j < 4; j++)
+                {
+                    uint64_t v;
+                    std::memcpy(&v, p_ + j * 8, 8);
+                    const uint64_t k = v ^ (hashKeys::lane[j] + s_ * hashKeys::step);
+                    acc[j] += v + (k & 0xffffffffULL) * (k >> 32);
+                }
+            };
+            for (; s < nStripe; s++)
+                stripe(p + s * 32, s);
+            // remainder, zero padded to a full stripe
+            if (const size_t rem = n_ - nStripe * 32)
+            {
+                std::byte tail[32] = {};
+                std::memcpy(tail, p + nStripe * 32, rem);
+                stripe(tail, nStripe);
+            }
+
+            uint64_t h = fmix64(n_);
+            for (const auto a : acc)
+                h = hashCombine(h, a);
+            return h;
+        }
+
+        struct inputFingerprint
+        {
+            uint64_t hash;
+            size_t   bytes;     // size of the input's data, including that of nested arrays
+        };
+        // returns nullopt if the input (or a nested array) is of a kind that is not cached
+        inline std::optional<inputFingerprint> fingerprint(const mxArray* inp_, uint64_t seed_ = 0)
+        {
+            if (!inp_)
+                return inputFingerprint{ hashCombine(seed_, 0), 0 };
+            if (mxIsSparse(inp_) || mxIsComplex(inp_))
+                return std::nullopt;
+
+            const auto classID = mxGetClassID(inp_);
+            const auto nDim    = mxGetNumberOfDimensions(inp_);
+            const auto dims    = mxGetDimensions(inp_);
+            const auto nElem   = mxGetNumberOfElements(inp_);
+            inputFingerprint out{ hashCombine(hashCombine(seed_, static_cast<uint64_t>(classID) + 1), nDim), 0 };
+            for (mwSize d = 0; d < nDim; d++)
+                out.hash = hashCombine(out.hash, dims[d]);
+
+            if (mxIsNumeric(inp_) || mxIsLogical(inp_) || mxIsChar(inp_))
+            {
+                out.bytes = nElem * mxGetElementSize(inp_);
+                out.hash  = hashCombine(out.hash, hashBytes(mxGetData(inp_), out.bytes));
+                return out;
+            }
+
+            // cells and structs: structure, then nested arrays in order
+            auto nested = [&out](const mxArray* child_)
+            {
+                const auto fp = fingerprint(child_, out.hash);
+                if (!fp)
+                    return false;
+                out.hash   = fp->hash;
+                out.bytes += fp->bytes + sizeof(mxArray*);
+                return true;
+            };
+            if (mxIsCell(inp_))
+            {
+                for (size_t i = 0; i < nElem; i++)
+                    if (!nested(mxGetCell(inp_, i)))
+                        return std::nullopt;
+                return out;
+            }
+            if (mxIsStruct(inp_))
+            {
+                const int nField = mxGetNumberOfFields(inp_);
+                out.hash = hashCombine(out.hash, static_cast<uint64_t>(nField));
+                for (int f = 0; f < nField; f++)
+                {
+                    const std::string_view name = mxGetFieldNameByNumber(inp_, f);
+                    out.hash = hashCombine(out.hash, hashBytes(name.data(), name.size()));
+                }
+                for (size_t i = 0; i < nElem; i++)
+                    for (int f = 0; f < nField; f++)
+                        if (!nested(mxGetFieldByNumber(inp_, i, f)))
+                            return std::nullopt;
+                return out;
+            }
+            // function handles, objects, etc
+            return std::nullopt;
+        }
+
+        // unique address per type, to key entries on the requested type
+        template <typename T>
+        inline constexpr char typeTag = 0;
+    }
+
+    class InputCache
+    {
+    public:
+        static constexpr size_t defaultBudget = size_t{ 64 } << 20;
+
+        explicit InputCache(size_t budget_ = defaultBudget) : _budget(budget_) {}
+        InputCache(const InputCache&) = delete;
+        InputCache& operator=(const InputCache&) = delete;
+
+        // as FromMatlab<OutputType>(nrhs, prhs, idx_, funcID_, offset_), but returns the object parsed
+        // on an earlier call if the input is unchanged. For std::optional<T>, returns a
+        // std::shared_ptr<const T> that is nullptr if the argument is not provided
+        template <typename OutputType>
+        std::shared_ptr<const typename unwrapOptional<OutputType>::type> get(int nrhs, const mxArray* prhs[], size_t idx_, std::string_view funcID_, size_t offset_ = 0)
+        {
+            using T = typename unwrapOptional<OutputType>::type;
+            constexpr bool isOptional = is_specialization_v<OutputType, std::optional>;
+
+            const bool haveElement = idx_ < static_cast<unsigned int>(nrhs) && !mxIsEmpty(prhs[idx_]);
+            if constexpr (isOptional)
+                if (!haveElement)
+                    return nullptr;
+            if (!haveElement)  // let FromMatlab throw its usual error
+                return std::make_shared<const T>(FromMatlab<T>(nrhs, prhs, idx_, funcID_, offset_));
+
+            const auto inp = prhs[idx_];
+            const auto fp  = detail::fingerprint(inp);
+            if (!fp)
+                return std::make_shared<const T>(FromMatlab<T>(nrhs, prhs, idx_, funcID_, offset_));
+
+            const Key key{ &detail::typeTag<T>, inp };
+            if (const auto it = _index.find(key); it != _index.end())
+            {
+                if (it->second->hash == fp->hash)
+                {
+                    _nHit++;
+                    _entries.splice(_entries.begin(), _entries, it->second);
+                    return std::static_pointer_cast<const T>(it->second->value);
+                }
+                // same input array, content changed: entry is stale
+                erase(it->second);
+            }
+
+            _nMiss++;
+            auto value = std::make_shared<const T>(FromMatlab<T>(nrhs, prhs, idx_, funcID_, offset_));
+            const size_t bytes = fp->bytes + sizeof(T);
+            if (bytes <= _budget)
+            {
+                _entries.push_front({ key, fp->hash, bytes, value });
+                _index.emplace(key, _entries.begin());
+                _bytes += bytes;
+                evictToBudget();
+            }
+            return value;
+        }
+
+        size_t budget() const { return _budget; }
+        // set the memory budget, evicting entries if needed
+        void setBudget(size_t budget_)
+        {
+            _budget = budget_;
+            evictToBudget();
+        }
+        // estimated memory use of the cached entries
+        size_t bytes() const { return _bytes; }
+        size_t size()  const { return _entries.size(); }
+        size_t nHit()  const { return _nHit; }
+        size_t nMiss() const { return _nMiss; }
+
+        void clear()
+        {
+            _index.clear();
+            _entries.clear();
+            _bytes = 0;
+        }
+
+    private:
+        struct Key
+        {
+            const void*    type;
+            const mxArray* input;
+            bool operator==(const Key&) const = default;
+        };
+        struct KeyHash
+        {
+            size_t operator()(const Key& k_) const
+            {
+                return static_cast<size_t>(detail::hashCombine(reinterpret_cast<uintptr_t>(k_.type), reinterpret_cast<uintptr_t>(k_.input)));
+            }
+        };
+        struct Entry
+        {
+            Key                         key;
+            uint64_t                    hash;
+            size_t                      bytes;
+            std::shared_ptr<const void> value;
+        };
+        using Iterator = std::list<Entry>::iterator;
+
+        void erase(Iterator it_)
+        {
+            _bytes -= it_->bytes;
+            _index.erase(it_->key);
+            _entries.erase(it_);
+        }
+        void evictToBudget()
+        {
+            while (_bytes > _budget)
+                erase(std::prev(_entries.end()));
+        }
+
+        size_t                                      _budget;
+        size_t                                      _bytes = 0;
+        size_t                                      _nHit  = 0;
+        size_t                                      _nMiss = 0;
+        std::list<Entry>                            _entries;   // most recently used first
+        std::unordered_map<Key, Iterator, KeyHash>  _index;
+    };
+
+    // process-wide cache, with the default budget
+    inline InputCache& DefaultInputCache()
+    {
+        static InputCache cache;
+        return cache;
+    }
+
+    // CachedFromMatlab<T>(...) is DefaultInputCache().get<T>(...)
+    template <typename OutputType>
+    auto CachedFromMatlab(int nrhs, const mxArray* prhs[], size_t idx_, std::string_view funcID_, size_t offset_ = 0)
+    {
+        return DefaultInputCache().get<OutputType>(nrhs, prhs, idx_, funcID_, offset_);
+    }
+}
@@ -3,14 +3,31 @@
 #include <string>
 #include <utility>
 #include <tuple>
+#include <variant>
 #include <type_traits>
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <functional>
+#include <limits>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <concepts>
+#include <memory_resource>
+#include <ranges>
+#include <string_view>
+#include <vector>
 
 #include "mex_type_utils_fwd.h"
 #include "is_container_trait.h"
 #include "is_specialization_trait.h"
 #include "replace_specialization_type.h"
 #include "invocable_traits.h"
+#include "bit_pack.h"
+#include "mex_arena.h"
+#include "scale_offset.h"
+#include "blocked_transpose.h"
 
 
 namespace mxTypes
@@ -36,10 +53,108 @@ namespace mxTypes
             return std::to_string(number) + suffix;
         }
 
+        // std::to_string is not constexpr
+        constexpr std::string NumberToString(size_t number)
+        {
+            std::string out;
+            do
+            {
+                out.insert(out.begin(), static_cast<char>('0' + number % 10));
+                number /= 10;
+            } while (number);
+            return out;
+        }
+
+        // traits of a converter function. The common cases (plain functions and functors/lambdas with a
+        // single non-overloaded unary operator()) are matched directly, only other callables go through
+        // the (much more expensive to instantiate) full invocable_traits machinery
+        template <typename R, typename A>
+        struct unaryConverterTraits
+        {
+            static constexpr bool ok = true;
+            using arg_t    = std::decay_t<A>;
+            using result_t = R;
+        };
+        template <typename F>
+        struct unaryConverterSignature : std::false_type {};
+        template <typename R, typename A>                struct unaryConverterSignature<R(*)(A)>                       : std::true_type, unaryConverterTraits<R, A> {};
+        template <typename R, typename A>                struct unaryConverterSignature<R(*)(A) noexcept>              : std::true_type, unaryConverterTraits<R, A> {};
+        template <typename R, typename C, typename A>    struct unaryConverterSignature<R(C::*)(A)>                    : std::true_type, unaryConverterTraits<R, A> {};
+        template <typename R, typename C, typename A>    struct unaryConverterSignature<R(C::*)(A) const>              : std::true_type, unaryConverterTraits<R, A> {};
+        template <typename R, typename C, typename A>    struct unaryConverterSignature<R(C::*)(A) noexcept>           : std::true_type, unaryConverterTraits<R, A> {};
+        template <typename R, typename C, typename A>    struct unaryConverterSignature<R(C::*)(A) const noexcept>     : std::true_type, unaryConverterTraits<R, A> {};
+
+        template <typename F, typename = void>
+        struct converterSignature : unaryConverterSignature<std::decay_t<F>> {};
+        template <typename F>
+        struct converterSignature<F, std::enable_if_t<std::is_class_v<std::decay_t<F>>, std::void_t<decltype(&std::decay_t<F>::operator())>>>
+            : unaryConverterSignature<decltype(&std::decay_t<F>::operator())> {};
+
+        template <typename F, bool = converterSignature<F>::value>
+        struct converterTraits : converterSignature<F>
+        {
+            static constexpr bool isFastPath = true;
+        };
+        template <typename F>
+        struct converterTraits<F, false>
+        {
+            static constexpr bool isFastPath = false;
+            using traits = invocable_traits::get<F>;
+            static constexpr bool ok = traits::error == invocable_traits::Error::None && traits::arity == 1;
+            using arg_t    = std::decay_t<typename traits::template arg_t<0>>;
+            using result_t = typename traits::invoke_result_t;
+        };
+        template <typename F>
+        using converterArg_t = typename converterTraits<F>::arg_t;
+        // for containers, the converter is applied to each element
+        template <typename T>
+        struct converterOutput { using type = T; };
+        template <typename T> requires (Container<T> && !std::is_same_v<T, std::string>)
+        struct converterOutput<T> { using type = typename T::value_type; };
+        template <typename T>
+        using converterOutput_t = typename converterOutput<T>::type;
+
+        // if simple type (e.g. int) or container of simple type (e.g. std::vector<int>),
+        // automatically add "scalar" or "array" to the type description
+        template <typename OutputType>
+        constexpr std::string_view argumentTypeSuffix()
+        {
+            if constexpr (std::is_arithmetic_v<OutputType> || Chrono<OutputType>)
+                return " scalar";
+            else if constexpr (Container<OutputType> && !std::is_same_v<OutputType, std::string> && !BitContainer<OutputType> && !FixedRow<OutputType>)
+            {
+                if constexpr (std::is_arithmetic_v<typename OutputType::value_type> || Chrono<typename OutputType::value_type>)
+                    return " array";
+                else
+                    return "";
+            }
+            else
+                return "";
+        }
+
         // forward declaration
         template <typename OutputType>
         constexpr std::string buildCorrespondingMatlabTypeString_impl();
         // end forward declaration
+        // e.g. "int32 scalar, double array or string". If withArticle_, each alternative is preceded by "a" or "an"
+        template <typename... Ts>
+        constexpr std::string buildVariantTypeString(std::type_identity<std::variant<Ts...>>, bool withArticle_)
+        {
+            constexpr size_t N = sizeof...(Ts);
+            std::string out;
+            size_t i = 0;
+            auto add = [&](std::string str_)
+            {
+                if (i)
+                    out += i == N - 1 ? " or " : ", ";
+                if (withArticle_)
+                    out += std::string_view("aeiou").find(str_[0]) == std::string_view::npos ? "a " : "an ";
+                out += str_;
+                i++;
+            };
+            (add(buildCorrespondingMatlabTypeString_impl<Ts>() + std::string(argumentTypeSuffix<Ts>())), ...);
+            return out;
+        }
         template <typename OutputType, bool IsContainer>
         constexpr std::string buildCorrespondingMatlabTypeString_impl()
         {
@@ -50,6 +165,43 @@ namespace mxTypes
                 else
                     return "string";
             }
+            else if constexpr (is_specialization_v<OutputType, std::variant>)
+            {
+                if constexpr (IsContainer && DenseVariant<OutputType>)
+                    return buildCorrespondingMatlabTypeString_impl<denseStorage_t<OutputType>, false>() + " array or cell array with each element " + buildVariantTypeString(std::type_identity<OutputType>{}, true);
+                else if constexpr (IsContainer)
+                    return "cell array with each element " + buildVariantTypeString(std::type_identity<OutputType>{}, true);
+                else
+                    return buildVariantTypeString(std::type_identity<OutputType>{}, false);
+            }
+            else if constexpr (is_specialization_v<OutputType, std::optional>)
+            {
+                const std::string typeStr = buildCorrespondingMatlabTypeString_impl<typename OutputType::value_type, false>();
+                if constexpr (IsContainer && DenseOptional<OutputType>)
+                    return typeStr + " array" + (std::is_floating_point_v<typename OutputType::value_type> ? " (NaN for missing values)" : "") + ", struct with fields values and valid, or cell array of " + typeStr + " scalars and empty arrays";
+                else if constexpr (IsContainer)
+                    return "cell array with each element a" + std::string(std::string_view("aeiou").find(typeStr[0]) == std::string_view::npos ? " " : "n ") + typeStr + " or empty array";
+                else
+                    return typeStr + " or empty array";
+            }
+            else if constexpr (RegisteredEnum<OutputType>)
+            {
+                std::string out = IsContainer ? "cellstring or struct with fields codes and names (values: " : "string (one of: ";
+                for (size_t i = 0; i < enumInfo<OutputType>::N; i++)
+                {
+                    if (i)
+                        out += ", ";
+                    out += enumInfo<OutputType>::names[i];
+                }
+                out += ")";
+                return out;
+            }
+            else if constexpr (Chrono<OutputType>)
+                // tick counts, see Ticks
+                return buildCorrespondingMatlabTypeString_impl<typename chronoTraits<OutputType>::rep, false>();
+            else if constexpr (std::is_same_v<OutputType, std::monostate>)
+                // e.g. alternative of a std::variant, see ToMatlab(std::monostate)
+                return "empty array";
             else
             {
                 constexpr mxClassID mxClass = typeToMxClass_v<OutputType>;
@@ -65,7 +217,7 @@ namespace mxTypes
                 outStr = "M";
             else
                 outStr = "1";
-            outStr += "x" + std::to_string(sizeof...(Args)) + " cell array ";
+            outStr += "x" + NumberToString(sizeof...(Args)) + " cell array ";
             if constexpr (IsContainer)
                 outStr += "with each row containing ";
             else
@@ -82,9 +234,29 @@ namespace mxTypes
         template <typename OutputType>
         constexpr std::string buildCorrespondingMatlabTypeString_impl()
         {
-            if constexpr (Container<OutputType> && !std::is_same_v<OutputType, std::string>)
+            if constexpr (BitContainer<OutputType>)
+            {
+                if constexpr (is_bitset<OutputType>::value)
+                    return "logical array with " + NumberToString(OutputType().size()) + " elements";
+                else
+                    return "logical array";
+            }
+            else if constexpr (Container<OutputType> && !std::is_same_v<OutputType, std::string>)
             {
-                if constexpr (is_specialization_v<typename OutputType::value_type, std::tuple> || is_specialization_v<typename OutputType::value_type, std::pair>)
+                if constexpr (RaggedContainer<OutputType> && FixedRow<typename OutputType::value_type>)
+                {
+                    std::string typeStr = buildCorrespondingMatlabTypeString_impl<typename OutputType::value_type::value_type, false>();
+                    std::string n       = NumberToString(std::tuple_size_v<typename OutputType::value_type>);
+                    return "cell array of " + typeStr + " arrays with " + n + " elements, ragged struct (with fields data and offsets) or " + typeStr + " matrix with " + n + " columns";
+                }
+                else if constexpr (RaggedContainer<OutputType>)
+                {
+                    std::string typeStr = buildCorrespondingMatlabTypeString_impl<typename OutputType::value_type::value_type, false>();
+                    return "cell array of " + typeStr + " arrays, ragged struct (with fields data and offsets) or " + typeStr + " matrix";
+                }
+                else if constexpr (FixedRow<OutputType>)
+                    return buildCorrespondingMatlabTypeString_impl<typename OutputType::value_type, false>() + " array with " + NumberToString(std::tuple_size_v<OutputType>) + " elements";
+                else if constexpr (is_specialization_v<typename OutputType::value_type, std::tuple> || is_specialization_v<typename OutputType::value_type, std::pair>)
                 {
                     using theTuple = typename OutputType::value_type;
                     return buildCorrespondingMatlabTypeString_impl<true>(theTuple(), std::make_index_sequence<std::tuple_size_v<theTuple>>{});
@@ -106,7 +278,7 @@ namespace mxTypes
         {
             if constexpr (!std::is_same_v<Converter, std::nullptr_t>)
             {
-                using ConverterInputType = std::decay_t<typename invocable_traits::get<Converter>::template arg_t<0>>;
+                using ConverterInputType = converterArg_t<Converter>;
                 if constexpr (Container<OutputType>)
                 {
                     using InputContainerType = replace_specialization_type_t<OutputType, ConverterInputType>;
@@ -119,10 +291,35 @@ namespace mxTypes
                 return buildCorrespondingMatlabTypeString_impl<OutputType>();
         }
 
+        // the type description strings are fully determined by the type, compute them at compile time
+        template <typename OutputType, typename Converter>
+        struct correspondingMatlabTypeString
+        {
+        private:
+            static constexpr auto storage = []
+            {
+                constexpr size_t N = buildCorrespondingMatlabTypeString<OutputType, Converter>().size();
+                std::array<char, N> out{};
+                const auto str = buildCorrespondingMatlabTypeString<OutputType, Converter>();
+                std::copy(str.begin(), str.end(), out.begin());
+                return out;
+            }();
+        public:
+            static constexpr std::string_view value{ storage.data(), storage.size() };
+        };
         template <typename OutputType, typename Converter>
-        void buildAndThrowError(std::string_view funcID_, size_t idx_, size_t offset_, int nrhs_, const mxArray* prhs_[], bool isOptional_, Converter conv_)
+        inline constexpr std::string_view correspondingMatlabTypeString_v = correspondingMatlabTypeString<OutputType, Converter>::value;
+
+#if defined(_MSC_VER)
+#   define MEX_INPUT_GETTER_COLD __declspec(noinline)
+#else
+#   define MEX_INPUT_GETTER_COLD __attribute__((noinline, cold))
+#endif
+        // error reporting is the same for all argument types given the type description, so keep it out
+        // of line and out of the per-type instantiations. typeSuffix_ is appended to the type description
+        // (e.g. " scalar" or " array")
+        [[noreturn]] MEX_INPUT_GETTER_COLD inline void throwArgumentError(std::string_view funcID_, size_t idx_, size_t offset_, int nrhs_, const mxArray* prhs_[], bool isOptional_, std::string_view typeStr_, std::string_view typeSuffix_)
         {
-            auto typeStr = buildCorrespondingMatlabTypeString<OutputType, Converter>();
             std::string out;
             out.reserve(100);
             out += "SWAG::";
@@ -135,27 +332,11 @@ namespace mxTypes
                 out += "Optional ";
             auto ordinal = idx_ - offset_ + 1;
             out += NumberToOrdinal(ordinal) + " argument must be a";
-            if (typeStr[0] == 'a' || typeStr[0] == 'e' || typeStr[0] == 'i' || typeStr[0] == 'o' || typeStr[0] == 'u')
+            if (typeStr_[0] == 'a' || typeStr_[0] == 'e' || typeStr_[0] == 'i' || typeStr_[0] == 'o' || typeStr_[0] == 'u')
                 out += "n";
-            out += " " + typeStr;
-
-            // if simple type (e.g. int) or container of simple type (e.g. std::vector<int>),
-            // automatically add "scalar" or "array" to the string
-            bool special = true;
-            if constexpr (std::is_arithmetic_v<OutputType>)
-                special = false;
-            else if constexpr (Container<OutputType> && !std::is_same_v<OutputType, std::string>)
-            {
-                if constexpr (std::is_arithmetic_v<typename OutputType::value_type>)
-                    special = false;
-            }
-            if (!special)
-            {
-                if constexpr (Container<OutputType>)
-                    out += " array";
-                else
-                    out += " scalar";
-            }
+            out += " ";
+            out += typeStr_;
+            out += typeSuffix_;
             out += ". ";
 
             // now say what the argument instead contained (and some special cases like
@@ -188,10 +369,30 @@ namespace mxTypes
             throw out;
         }
 
+        [[noreturn]] MEX_INPUT_GETTER_COLD inline void throwTooManyArguments(std::string_view funcID_, size_t nExpected_, size_t nProvided_)
+        {
+            std::string out = "SWAG::";
+            if (!funcID_.empty())
+            {
+                out += funcID_;
+                out += ": ";
+            }
+            out += "Too many input arguments. At most " + std::to_string(nExpected_) + " were expected, " + std::to_string(nProvided_) + " were provided.";
+            throw out;
+        }
+
+        template <typename OutputType, typename Converter>
+        [[noreturn]] void buildAndThrowError(std::string_view funcID_, size_t idx_, size_t offset_, int nrhs_, const mxArray* prhs_[], bool isOptional_, Converter)
+        {
+            throwArgumentError(funcID_, idx_, offset_, nrhs_, prhs_, isOptional_, correspondingMatlabTypeString_v<OutputType, Converter>, argumentTypeSuffix<OutputType>());
+        }
+
 
         // forward declaration
         template <typename OutputType, typename Converter>
         bool checkInput(const mxArray* inp_, Converter conv_);
+        template <typename Variant>
+        struct variantInfo;
         // end forward declarations
 
 
@@ -216,13 +417,230 @@ namespace mxTypes
             return true;
         }
 
+        template <typename OutputType>
+        bool checkInput_impl_ragged(const mxArray* inp_)
+        {
+            // ragged struct, see ToMatlab(..., Ragged)
+            if (!mxIsStruct(inp_) || !mxIsScalar(inp_))
+                return false;
+            const mxArray* data    = mxGetField(inp_, 0, "data");
+            const mxArray* offsets = mxGetField(inp_, 0, "offsets");
+            if (!data || !offsets || mxIsComplex(data) || mxIsSparse(data) || mxIsComplex(offsets) || mxIsSparse(offsets))
+                return false;
+            if (mxGetClassID(data) != typeToMxClass_v<typename OutputType::value_type::value_type> || mxGetClassID(offsets) != mxUINT64_CLASS || mxIsEmpty(offsets))
+                return false;
+
+            // offsets must start at 0, be non-decreasing and end at the number of elements in data
+            const auto off   = static_cast<const uint64_t*>(mxGetData(offsets));
+            const auto nOff  = mxGetNumberOfElements(offsets);
+            if (off[0] != 0 || off[nOff - 1] != mxGetNumberOfElements(data))
+                return false;
+            if constexpr (FixedRow<typename OutputType::value_type>)
+            {
+                // each inner container must have exactly N elements
+                constexpr size_t N = std::tuple_size_v<typename OutputType::value_type>;
+                for (size_t i = 0; i < nOff; i++)
+                    if (off[i] != i * N)
+                        return false;
+                return true;
+            }
+            else
+                return std::is_sorted(off, off + nOff);
+        }
+
+        // dense encoding of a container of std::optional or std::variant arithmetic values, see Dense tag
+        inline bool getDenseOptionalFields(const mxArray* inp_, const mxArray*& values_, const mxArray*& valid_)
+        {
+            if (!mxIsStruct(inp_) || !mxIsScalar(inp_))
+                return false;
+            values_ = mxGetField(inp_, 0, "values");
+            valid_  = mxGetField(inp_, 0, "valid");
+            return values_ && valid_ && mxIsLogical(valid_) && !mxIsComplex(values_) && !mxIsSparse(values_) && !mxIsSparse(valid_) &&
+                mxGetNumberOfElements(values_) == mxGetNumberOfElements(valid_);
+        }
+
+        template <DenseElement V>
+        bool checkInput_impl_dense(const mxArray* inp_)
+        {
+            using T = denseStorage_t<V>;
+            if constexpr (DenseOptional<V>)
+            {
+                const mxArray* values;
+                const mxArray* valid;
+                if (mxIsStruct(inp_))
+                    return getDenseOptionalFields(inp_, values, valid) && mxGetClassID(values) == typeToMxClass_v<T>;
+            }
+            return mxGetClassID(inp_) == typeToMxClass_v<T>;
+        }
+
+        // whether v_ converts to To and back without change
+        template <typename To, typename From>
+        bool representsExactly(From v_)
+        {
+            if constexpr (std::is_same_v<To, From>)
+                return true;
+            else if constexpr (std::is_same_v<To, bool>)
+                return v_ == From{ 0 } || v_ == From{ 1 };
+            else if constexpr (std::is_integral_v<To> && std::is_floating_point_v<From>)
+            {
+                // NB: the bounds are powers of 2, so exactly representable. NaN fails the comparisons
+                constexpr From hi = []
+                {
+                    From out = 1;
+                    for (int i = 0; i < std::numeric_limits<To>::digits; i++)
+                        out *= 2;
+                    return out;
+                }();
+                constexpr From lo = std::is_signed_v<To> ? -hi : From{ 0 };
+                return v_ >= lo && v_ < hi && static_cast<From>(static_cast<To>(v_)) == v_;
+            }
+            else if constexpr (std::is_integral_v<To>)
+            {
+                if constexpr (std::is_same_v<From, bool>)
+                    return true;
+                else
+                    return std::in_range<To>(v_);
+            }
+            else if constexpr (std::is_floating_point_v<From>)
+            {
+                if constexpr (sizeof(To) >= sizeof(From))
+                    return true;
+                else
+                    return std::isinf(v_) || (std::abs(v_) <= std::numeric_limits<To>::max() && static_cast<From>(static_cast<To>(v_)) == v_);
+            }
+            else
+                // integer to floating point
+                return representsExactly<From>(static_cast<To>(v_)) && static_cast<From>(static_cast<To>(v_)) == v_;
+        }
+
+        // variant holding the first alternative that represents v_ exactly. If there is none, the alternative of
+        // type T if there is one, else the first alternative
+        template <typename Variant, typename T>
+        Variant denseVariantValue(T v_)
+        {
+            return [v_]<size_t... Is>(std::index_sequence<Is...>)
+            {
+                Variant out;
+                bool found = false;
+                auto tryAlternative = [&]<size_t I>(std::integral_constant<size_t, I>)
+                {
+                    using A = std::variant_alternative_t<I, Variant>;
+                    if (!found && representsExactly<A>(v_))
+                    {
+                        out.template emplace<I>(static_cast<A>(v_));
+                        found = true;
+                    }
+                };
+                (tryAlternative(std::integral_constant<size_t, Is>{}), ...);
+                if (!found)
+                {
+                    constexpr size_t iT = std::min({ (std::is_same_v<std::variant_alternative_t<Is, Variant>, T> ? Is : sizeof...(Is))... });
+                    constexpr size_t iFallback = iT < sizeof...(Is) ? iT : 0;
+                    out.template emplace<iFallback>(static_cast<std::variant_alternative_t<iFallback, Variant>>(v_));
+                }
+                return out;
+            }(std::make_index_sequence<std::variant_size_v<Variant>>{});
+        }
+
+        template <typename OutputType>
+        OutputType getValue_impl_dense(const mxArray* inp_)
+        {
+            using V = typename OutputType::value_type;
+            using T = denseStorage_t<V>;
+            OutputType out;
+            const mxArray* values = inp_;
+            const mxArray* valid  = nullptr;
+            if constexpr (DenseOptional<V>)
+                if (mxIsStruct(inp_))
+                    getDenseOptionalFields(inp_, values, valid);
+
+            const auto data  = static_cast<const T*>(mxGetData(values));
+            const auto numel = mxGetNumberOfElements(values);
+            if constexpr (requires { out.reserve(numel); })
+                out.reserve(numel);
+            if constexpr (DenseVariant<V>)
+            {
+                for (size_t i = 0; i < numel; i++)
+                    out.emplace_back(denseVariantValue<V>(data[i]));
+            }
+            else if (valid)
+            {
+                const auto mask = static_cast<const mxLogical*>(mxGetData(valid));
+                for (size_t i = 0; i < numel; i++)
+                    out.emplace_back(mask[i] ? V(data[i]) : V());
+            }
+            else
+            {
+                for (size_t i = 0; i < numel; i++)
+                {
+                    if constexpr (std::is_floating_point_v<T>)
+                        out.emplace_back(std::isnan(data[i]) ? V() : V(data[i]));
+                    else
+                        out.emplace_back(data[i]);
+                }
+            }
+            return out;
+        }
+
+        // index into enum table of the value named by the string in inp_, npos if not a registered name
+        template <RegisteredEnum E>
+        size_t enumIndexFromMatlab(const mxArray* inp_)
+        {
+            using info = enumInfo<E>;
+            if (!mxIsChar(inp_))
+                return info::npos;
+            // names are short, copy into buffer on the stack. A string that doesn't fit (mxGetString
+            // returns non-zero when truncating) can't be a registered name
+            std::array<char, info::maxNameLength + 2> buf;
+            if (mxGetString(inp_, buf.data(), static_cast<mwSize>(buf.size())))
+                return info::npos;
+            return info::indexOf(std::string_view{ buf.data() });
+        }
+
+        // struct with codes and names (or index and categories) fields, see ToMatlab(..., EnumCodes) and ToMatlab(..., EnumCategorical)
+        inline bool getEnumCodesFields(const mxArray* inp_, const mxArray*& codes_, const mxArray*& names_)
+        {
+            if (!mxIsStruct(inp_) || !mxIsScalar(inp_))
+                return false;
+            codes_ = mxGetField(inp_, 0, "codes");
+            names_ = mxGetField(inp_, 0, "names");
+            if (!codes_ && !names_)
+            {
+                codes_ = mxGetField(inp_, 0, "index");
+                names_ = mxGetField(inp_, 0, "categories");
+            }
+            return codes_ && names_ && mxIsCell(names_) && mxIsNumeric(codes_) && !mxIsComplex(codes_) && !mxIsSparse(codes_);
+        }
+
+        template <RegisteredEnum E>
+        bool checkInput_impl_enumCodes(const mxArray* inp_)
+        {
+            const mxArray* codes;
+            const mxArray* names;
+            if (!getEnumCodesFields(inp_, codes, names))
+                return false;
+
+            const auto nName = mxGetNumberOfElements(names);
+            for (mwIndex i = 0; i < nName; i++)
+                if (enumIndexFromMatlab<E>(mxGetCell(names, i)) == enumInfo<E>::npos)
+                    return false;
+            return VisitNumeric(codes, [nName](auto data_, auto)
+            {
+                return std::all_of(data_.begin(), data_.end(), [nName](auto c_)
+                {
+                    const auto c = static_cast<double>(c_);
+                    return c >= 1 && c <= static_cast<double>(nName) && c == std::floor(c);
+                });
+            });
+        }
+
         template <typename OutputType, typename Converter>
         bool checkInput(const mxArray* inp_, Converter conv_)
         {
             if constexpr (!std::is_same_v<Converter, std::nullptr_t>)
             {
                 // check for input data type of converter
-                using ConverterInputType = std::decay_t<typename invocable_traits::get<Converter>::template arg_t<0>>;
+                using ConverterInputType = converterArg_t<Converter>;
                 if constexpr (Container<OutputType>)
                 {
                     using InputContainerType = replace_specialization_type_t<OutputType, ConverterInputType>;
@@ -231,13 +649,22 @@ namespace mxTypes
                 else
                     return checkInput<ConverterInputType>(inp_, nullptr);
             }
+            else if constexpr (is_specialization_v<OutputType, std::variant>)
+                return variantInfo<OutputType>::find(inp_) != variantInfo<OutputType>::npos;
             else
             {
                 // early out for complex or sparse arguments, never wanted by us
                 if (mxIsComplex(inp_) || mxIsSparse(inp_))
                     return false;
 
-                if constexpr (Container<OutputType>)
+                if constexpr (BitContainer<OutputType>)
+                {
+                    if constexpr (is_bitset<OutputType>::value)
+                        return mxIsLogical(inp_) && mxGetNumberOfElements(inp_) == OutputType().size();
+                    else
+                        return mxIsLogical(inp_);
+                }
+                else if constexpr (Container<OutputType>)
                 {
                     if constexpr (
                         is_specialization_v<typename OutputType::value_type, std::pair> ||
@@ -263,6 +690,44 @@ namespace mxTypes
                     }
                     else if constexpr (std::is_same_v<OutputType, std::string>)
                         return mxIsChar(inp_);
+                    else if constexpr (RaggedContainer<OutputType>)
+                    {
+                        // cell array of arrays, ragged struct or matrix (each row is an inner container)
+                        if (mxIsCell(inp_))
+                            return checkInput_impl_cell<typename OutputType::value_type>(inp_);
+                        else if (mxIsStruct(inp_))
+                            return checkInput_impl_ragged<OutputType>(inp_);
+                        else if constexpr (FixedRow<typename OutputType::value_type>)
+                            return mxGetClassID(inp_) == typeToMxClass_v<typename OutputType::value_type::value_type> && mxGetNumberOfDimensions(inp_) == 2 && mxGetN(inp_) == std::tuple_size_v<typename OutputType::value_type>;
+                        else
+                            return mxGetClassID(inp_) == typeToMxClass_v<typename OutputType::value_type::value_type> && mxGetNumberOfDimensions(inp_) == 2;
+                    }
+                    else if constexpr (RegisteredEnum<typename OutputType::value_type>)
+                    {
+                        // cellstring, or struct with codes and names
+                        if (mxIsCell(inp_))
+                            return checkInput_impl_cell<typename OutputType::value_type>(inp_);
+                        else
+                            return checkInput_impl_enumCodes<typename OutputType::value_type>(inp_);
+                    }
+                    else if constexpr (DenseElement<typename OutputType::value_type>)
+                    {
+                        // cell array, or dense encoding
+                        if (mxIsCell(inp_))
+                            return checkInput_impl_cell<typename OutputType::value_type>(inp_);
+                        else
+                            return checkInput_impl_dense<typename OutputType::value_type>(inp_);
+                    }
+                    else if constexpr (FixedRow<OutputType>)
+                        return mxGetClassID(inp_) == typeToMxClass_v<typename OutputType::value_type> && mxGetNumberOfElements(inp_) == std::tuple_size_v<OutputType>;
+                    else if constexpr (Chrono<typename OutputType::value_type>)
+                    {
+                        // cell array, or array of tick counts
+                        if (mxIsCell(inp_))
+                            return checkInput_impl_cell<typename OutputType::value_type>(inp_);
+                        else
+                            return mxGetClassID(inp_) == typeToMxClass_v<typename chronoTraits<typename OutputType::value_type>::rep>;
+                    }
                     else
                     {
                         if constexpr (typeNeedsMxCellStorage_v<typename OutputType::value_type>)
@@ -282,6 +747,15 @@ namespace mxTypes
                     // it does not check whether type could be acquired losslessly through a cast
                     if constexpr (is_specialization_v<OutputType, std::pair> || is_specialization_v<OutputType, std::tuple>)
                         return checkInput_tuple(inp_, OutputType(), std::make_index_sequence<std::tuple_size_v<OutputType>>{});
+                    else if constexpr (RegisteredEnum<OutputType>)
+                        return enumIndexFromMatlab<OutputType>(inp_) != enumInfo<OutputType>::npos;
+                    else if constexpr (is_specialization_v<OutputType, std::optional>)
+                        // e.g. element of a cell array, empty for nullopt
+                        return mxIsEmpty(inp_) || checkInput<typename OutputType::value_type>(inp_, nullptr);
+                    else if constexpr (Chrono<OutputType>)
+                        return checkInput<typename chronoTraits<OutputType>::rep>(inp_, nullptr);
+                    else if constexpr (std::is_same_v<OutputType, std::monostate>)
+                        return mxIsEmpty(inp_);
                     else
                         return mxGetClassID(inp_) == typeToMxClass_v<OutputType> && mxIsScalar(inp_);
                 }
@@ -293,8 +767,132 @@ namespace mxTypes
         // forward declarations
         template <typename OutputType, typename Converter>
         OutputType getValue(const mxArray* inp_, Converter conv_);
+        template <typename OutputType>
+        std::optional<OutputType> tryGetValue(const mxArray* inp_);
         // end forward declarations
 
+        //// std::variant input: the alternatives that may accept an input are determined by the input's class and
+        //// whether it is a scalar, through a table built at compile time. Only when there are multiple
+        //// candidates are they tried in order (first match wins)
+        inline constexpr size_t nVariantClass = 32;     // NB: all mxClassIDs of interest are smaller, the rest share the last entry
+        inline constexpr size_t nVariantForm  = 2 * nVariantClass;
+        constexpr size_t variantFormIndex(mxClassID class_, bool isScalar_)
+        {
+            const auto c = static_cast<size_t>(class_);
+            return 2 * (c < nVariantClass ? c : nVariantClass - 1) + !isScalar_;
+        }
+
+        // forms (class and scalar or not) that may be accepted for an output type
+        template <typename T>
+        constexpr std::array<bool, nVariantForm> variantForms()
+        {
+            std::array<bool, nVariantForm> out{};
+            auto add = [&out](mxClassID class_, bool scalar_, bool array_)
+            {
+                out[variantFormIndex(class_, true)]  |= scalar_;
+                out[variantFormIndex(class_, false)] |= array_;
+            };
+            if constexpr (std::is_arithmetic_v<T>)
+                add(typeToMxClass_v<T>, true, false);
+            else if constexpr (Chrono<T>)
+                add(typeToMxClass_v<typename chronoTraits<T>::rep>, true, false);
+            else if constexpr (std::is_same_v<T, std::monostate>)
+            {
+                // empty array of any class
+                for (size_t c = 0; c < nVariantClass; c++)
+                    add(static_cast<mxClassID>(c), false, true);
+            }
+            else if constexpr (std::is_same_v<T, std::string> || RegisteredEnum<T>)
+                add(mxCHAR_CLASS, true, true);
+            else if constexpr (BitContainer<T>)
+                add(mxLOGICAL_CLASS, true, true);
+            else if constexpr (is_specialization_v<T, std::pair> || is_specialization_v<T, std::tuple>)
+                add(mxCELL_CLASS, true, true);
+            else if constexpr (Container<T>)
+            {
+                using V = typename T::value_type;
+                add(mxCELL_CLASS, true, true);
+                if constexpr (RaggedContainer<T>)
+                {
+                    add(mxSTRUCT_CLASS, true, false);
+                    add(typeToMxClass_v<typename V::value_type>, true, true);
+                }
+                else if constexpr (RegisteredEnum<V>)
+                    add(mxSTRUCT_CLASS, true, false);
+                else if constexpr (DenseElement<V>)
+                {
+                    add(typeToMxClass_v<denseStorage_t<V>>, true, true);
+                    if constexpr (DenseOptional<V>)
+                        add(mxSTRUCT_CLASS, true, false);
+                }
+                else if constexpr (std::is_arithmetic_v<V>)
+                    add(typeToMxClass_v<V>, true, true);
+                else if constexpr (Chrono<V>)
+                    add(typeToMxClass_v<typename chronoTraits<V>::rep>, true, true);
+            }
+            else
+                out.fill(true);     // unknown, always try
+            return out;
+        }
+
+        template <typename... Ts>
+        struct variantInfo<std::variant<Ts...>>
+        {
+            using Variant = std::variant<Ts...>;
+            static constexpr size_t N    = sizeof...(Ts);
+            static constexpr size_t npos = N;
+            static_assert(N <= 64, "std::variant input supports at most 64 alternatives");
+
+            // for each form, bitmask of candidate alternatives
+            static constexpr std::array<uint64_t, nVariantForm> candidates = []
+            {
+                constexpr std::array<std::array<bool, nVariantForm>, N> forms = { variantForms<Ts>()... };
+                std::array<uint64_t, nVariantForm> out{};
+                for (size_t i = 0; i < N; i++)
+                    for (size_t f = 0; f < nVariantForm; f++)
+                        if (forms[i][f])
+                            out[f] |= uint64_t{ 1 } << i;
+                return out;
+            }();
+            static constexpr std::array<bool(*)(const mxArray*), N> checkers = { +[](const mxArray* inp_) { return checkInput<Ts>(inp_, nullptr); }... };
+            static constexpr std::array<Variant(*)(const mxArray*), N> getters = []<size_t... Is>(std::index_sequence<Is...>)
+            {
+                return std::array<Variant(*)(const mxArray*), N>{ +[](const mxArray* inp_) { return Variant(std::in_place_index<Is>, getValue<Ts>(inp_, nullptr)); }... };
+            }(std::index_sequence_for<Ts...>{});
+            static constexpr std::array<std::optional<Variant>(*)(const mxArray*), N> tryGetters = []<size_t... Is>(std::index_sequence<Is...>)
+            {
+                return std::array<std::optional<Variant>(*)(const mxArray*), N>{ +[](const mxArray* inp_) -> std::optional<Variant>
+                {
+                    if (auto v = tryGetValue<Ts>(inp_))
+                        return Variant(std::in_place_index<Is>, std::move(*v));
+                    return std::nullopt;
+                }... };
+            }(std::index_sequence_for<Ts...>{});
+
+            // index of the alternative to use for the input, npos if none accepts it
+            static size_t find(const mxArray* inp_)
+            {
+                auto cand = candidates[variantFormIndex(mxGetClassID(inp_), mxIsScalar(inp_))];
+                for (; cand; cand &= cand - 1)
+                {
+                    const auto i = static_cast<size_t>(std::countr_zero(cand));
+                    if (checkers[i](inp_))
+                        return i;
+                }
+                return npos;
+            }
+            // value of the first alternative that accepts the input, nullopt if none does. Unlike find()
+            // followed by getters[], each candidate's input is checked only once
+            static std::optional<Variant> tryGet(const mxArray* inp_)
+            {
+                auto cand = candidates[variantFormIndex(mxGetClassID(inp_), mxIsScalar(inp_))];
+                for (; cand; cand &= cand - 1)
+                    if (auto v = tryGetters[static_cast<size_t>(std::countr_zero(cand))](inp_))
+                        return v;
+                return std::nullopt;
+            }
+        };
+
         template <template <class...> class TP, class... Args, size_t... Is>
         TP<Args...> getValue_tuple(const mxArray* inp_, TP<Args...>&&, std::index_sequence<Is...>, mwIndex iRow_ = 0, mwSize nRow_ = 1)
         {
@@ -304,17 +902,114 @@ namespace mxTypes
                 return std::make_pair (getValue<Args>(mxGetCell(inp_, iRow_ + (Is)*nRow_), nullptr) ...);
         }
 
+        // copy of a char array in scratch memory (see Scratch())
+        inline std::string_view getScratchString(const mxArray* inp_)
+        {
+            // NB: allow for multibyte encoding of non-ASCII characters
+            const auto bufLen = 3 * mxGetNumberOfElements(inp_) + 1;
+            auto buf = static_cast<char*>(Scratch()->allocate(bufLen, 1));
+            mxGetString(inp_, buf, static_cast<mwSize>(bufLen));
+            return { buf };
+        }
+
+        // append nRow_ inner containers to out_, from the rows of a row-major nRow_ x nCol_ matrix
+        template <typename OutputType, typename V>
+        void appendRows(OutputType& out_, const V* data_, size_t nRow_, size_t nCol_)
+        {
+            using Inner = typename OutputType::value_type;
+            if constexpr (FixedRow<Inner> && ContiguousStorage<OutputType> && requires { out_.resize(nRow_); })
+            {
+                static_assert(sizeof(Inner) == sizeof(V) * std::tuple_size_v<Inner>);
+                const auto n = out_.size();
+                out_.resize(n + nRow_);
+                if (nRow_)
+                    std::memcpy(static_cast<void*>(std::data(out_) + n), data_, nRow_ * sizeof(Inner));
+            }
+            else
+            {
+                for (size_t r = 0; r < nRow_; r++, data_ += nCol_)
+                {
+                    if constexpr (FixedRow<Inner>)
+                        std::copy_n(data_, nCol_, out_.emplace_back().begin());
+                    else
+                        out_.emplace_back(data_, data_ + nCol_);
+                }
+            }
+        }
+
+        // matrix, each row an inner container of out_. MATLAB matrices are column-major, so the rows are transposed
+        // with a cache-blocked kernel (see blocked_transpose.h): straight into the output for a contiguous container
+        // of std::arrays, else a block of rows at a time into scratch memory from which the inner containers are
+        // constructed
+        template <typename OutputType>
+        void getValue_impl_rows(const mxArray* inp_, OutputType& out_)
+        {
+            using Inner = typename OutputType::value_type;
+            using V     = typename Inner::value_type;
+            const auto data = static_cast<const V*>(mxGetData(inp_));
+            const size_t nRow = mxGetM(inp_);
+            const size_t nCol = mxGetN(inp_);
+            if constexpr (FixedRow<Inner> && ContiguousStorage<OutputType> && requires { out_.resize(nRow); })
+            {
+                // NB: number of columns checked against the std::array's size
+                static_assert(sizeof(Inner) == sizeof(V) * std::tuple_size_v<Inner>);
+                out_.resize(nRow);
+                if (nRow)
+                    blocked_transpose::toRowMajor<std::tuple_size_v<Inner>>(data, nRow, nRow, nCol, reinterpret_cast<V*>(std::data(out_)));
+            }
+            else
+            {
+                if constexpr (requires { out_.reserve(nRow); })
+                    out_.reserve(nRow);
+                constexpr size_t blockBytes = size_t{ 256 } << 10;
+                const size_t nBlock = std::max<size_t>(blockBytes / (std::max<size_t>(nCol, 1) * sizeof(V)), 1);
+                ArenaScope scratchScope;
+                auto buf = static_cast<V*>(Scratch()->allocate(std::min(nBlock, nRow) * nCol * sizeof(V) + 1, alignof(V)));
+                for (size_t r = 0; r < nRow; r += nBlock)
+                {
+                    const size_t n = std::min(nBlock, nRow - r);
+                    blocked_transpose::toRowMajor(data + r, nRow, n, nCol, buf);
+                    appendRows(out_, buf, n, nCol);
+                }
+            }
+        }
+
+        // container of std::chrono values from n_ tick counts
+        template <typename OutputType>
+        OutputType getValue_impl_chrono(const typename chronoTraits<typename OutputType::value_type>::rep* reps_, size_t n_)
+        {
+            using V = typename OutputType::value_type;
+            OutputType out;
+            if constexpr (ContiguousStorage<OutputType> && chronoIsRep<V> && requires { out.resize(n_); })
+            {
+                out.resize(n_);
+                if (n_)
+                    std::memcpy(static_cast<void*>(std::data(out)), reps_, n_ * sizeof(V));
+            }
+            else
+            {
+                if constexpr (requires { out.reserve(n_); })
+                    out.reserve(n_);
+                for (size_t i = 0; i < n_; i++)
+                    out.emplace_back(chronoTraits<V>::fromCount(reps_[i]));
+            }
+            return out;
+        }
+
         template <typename OutputType, typename Converter>
         OutputType getValue(const mxArray* inp_, Converter conv_)
         {
             if constexpr (!std::is_same_v<Converter, std::nullptr_t>)
             {
                 // apply converter function
-                using ConverterInputType = std::decay_t<typename invocable_traits::get<Converter>::template arg_t<0>>;
+                using ConverterInputType = converterArg_t<Converter>;
                 if constexpr (is_specialization_v<ConverterInputType, std::basic_string_view>)
-                    // if a string_view is the input to the converter function, get a
-                    // temporary std::string instead, else we have a lifetime issue.
-                    return std::invoke(conv_, getValue<std::string>(inp_, nullptr));
+                {
+                    // if a string_view is the input to the converter function, copy the string
+                    // into scratch memory that lives for the duration of the call
+                    ArenaScope scratchScope;
+                    return std::invoke(conv_, getScratchString(inp_));
+                }
                 else if constexpr (Container<OutputType>)
                 {
                     OutputType out;
@@ -325,7 +1020,7 @@ namespace mxTypes
                         out.reserve(nElem);
                         for (mwIndex i = 0; i < nElem; i++)
                             // get each element using non-converter getValue, then invoke converter on it
-                            out.emplace_back(std::invoke(conv_, getValue<ConverterInputType>(mxGetCell(inp_, i)), nullptr));
+                            out.emplace_back(std::invoke(conv_, getValue<ConverterInputType>(mxGetCell(inp_, i), nullptr)));
                     }
                     else
                     {
@@ -339,10 +1034,46 @@ namespace mxTypes
                     // single value, use non-converter getValue to get it, then invoke converter on it
                     return std::invoke(conv_, getValue<ConverterInputType>(inp_, nullptr));
             }
+            else if constexpr (is_specialization_v<OutputType, std::variant>)
+                return variantInfo<OutputType>::getters[variantInfo<OutputType>::find(inp_)](inp_);
             else
             {
                 // copy over data without converter function
-                if constexpr (Container<OutputType>)
+                if constexpr (BitContainer<OutputType>)
+                {
+                    const auto data  = static_cast<const mxLogical*>(mxGetData(inp_));
+                    const auto numel = mxGetNumberOfElements(inp_);
+                    OutputType out;
+                    if constexpr (is_bitset<OutputType>::value)
+                    {
+                        if constexpr (OutputType().size() <= 64)
+                        {
+                            // single word
+                            uint64_t word = 0;
+                            bit_pack::pack(data, numel, &word);
+                            out = OutputType(word);
+                        }
+                        else
+                        {
+                            // NB: std::bitset offers no access to its words
+                            for (size_t i = 0; i < numel; i++)
+                                out[i] = data[i];
+                        }
+                    }
+                    else
+                    {
+#if BIT_PACK_HAVE_VECTOR_WORDS
+                        // pack 64 values at a time
+                        out.resize(numel);
+                        if (numel)
+                            bit_pack::pack(data, numel, bit_pack::vector_words(out));
+#else
+                        out.assign(data, data + numel);
+#endif
+                    }
+                    return out;
+                }
+                else if constexpr (Container<OutputType>)
                 {
                     if constexpr (
                         is_specialization_v<typename OutputType::value_type, std::pair> ||
@@ -359,6 +1090,49 @@ namespace mxTypes
 
                         return out;
                     }
+                    else if constexpr (RaggedContainer<OutputType>)
+                    {
+                        using Inner = typename OutputType::value_type;
+                        using V     = typename Inner::value_type;
+                        OutputType out;
+                        if (mxIsCell(inp_))
+                        {
+                            const auto nElem = static_cast<mwIndex>(mxGetNumberOfElements(inp_));
+                            if constexpr (requires { out.reserve(nElem); })
+                                out.reserve(nElem);
+                            for (mwIndex i = 0; i < nElem; i++)
+                                out.emplace_back(getValue<Inner>(mxGetCell(inp_, i), nullptr));
+                        }
+                        else if (mxIsStruct(inp_))
+                        {
+                            // ragged struct
+                            const mxArray* offsets = mxGetField(inp_, 0, "offsets");
+                            const auto data  = static_cast<const V*>(mxGetData(mxGetField(inp_, 0, "data")));
+                            const auto off   = static_cast<const uint64_t*>(mxGetData(offsets));
+                            const auto nElem = mxGetNumberOfElements(offsets) - 1;
+                            if constexpr (requires { out.reserve(nElem); })
+                                out.reserve(nElem);
+                            if constexpr (FixedRow<Inner>)
+                                // NB: checked that each has N elements, so data is a row-major matrix
+                                appendRows(out, data, nElem, std::tuple_size_v<Inner>);
+                            else
+                            {
+                                for (size_t i = 0; i < nElem; i++)
+                                    out.emplace_back(data + off[i], data + off[i + 1]);
+                            }
+                        }
+                        else
+                            // matrix, each row is an inner container
+                            getValue_impl_rows(inp_, out);
+                        return out;
+                    }
+                    else if constexpr (FixedRow<OutputType>)
+                    {
+                        // NB: checked the number of elements
+                        OutputType out;
+                        std::copy_n(static_cast<const typename OutputType::value_type*>(mxGetData(inp_)), out.size(), out.begin());
+                        return out;
+                    }
                     else
                     {
                         static_assert(!is_specialization_v<OutputType, std::basic_string_view>, "Can't return a string view, would be dangling");
@@ -379,6 +1153,34 @@ namespace mxTypes
                                     out.emplace_back(getValue<typename OutputType::value_type>(mxGetCell(inp_, i), nullptr));
                                 return out;
                             }
+                            else if constexpr (RegisteredEnum<typename OutputType::value_type>)
+                            {
+                                // struct with codes and names: look up each name once, then map the codes
+                                using E = typename OutputType::value_type;
+                                const mxArray* codes;
+                                const mxArray* names;
+                                getEnumCodesFields(inp_, codes, names);
+                                ArenaScope scratchScope;
+                                std::pmr::vector<E> values(Scratch());
+                                const auto nName = static_cast<mwIndex>(mxGetNumberOfElements(names));
+                                values.reserve(nName);
+                                for (mwIndex i = 0; i < nName; i++)
+                                    values.push_back(enumInfo<E>::table[enumIndexFromMatlab<E>(mxGetCell(names, i))].first);
+
+                                OutputType out;
+                                if constexpr (requires { out.reserve(0); })
+                                    out.reserve(mxGetNumberOfElements(codes));
+                                VisitNumeric(codes, [&](auto data_, auto)
+                                {
+                                    for (auto c : data_)
+                                        out.emplace_back(values[static_cast<size_t>(c) - 1]);
+                                });
+                                return out;
+                            }
+                            else if constexpr (DenseElement<typename OutputType::value_type>)
+                                return getValue_impl_dense<OutputType>(inp_);
+                            else if constexpr (Chrono<typename OutputType::value_type>)
+                                return getValue_impl_chrono<OutputType>(static_cast<const typename chronoTraits<typename OutputType::value_type>::rep*>(mxGetData(inp_)), mxGetNumberOfElements(inp_));
                             else
                             {
                                 auto data = static_cast<typename OutputType::value_type*>(mxGetData(inp_));
@@ -392,6 +1194,14 @@ namespace mxTypes
                 {
                     if constexpr (is_specialization_v<OutputType, std::pair> || is_specialization_v<OutputType, std::tuple>)
                         return getValue_tuple(inp_, OutputType(), std::make_index_sequence<std::tuple_size_v<OutputType>>{});
+                    else if constexpr (RegisteredEnum<OutputType>)
+                        return enumInfo<OutputType>::table[enumIndexFromMatlab<OutputType>(inp_)].first;
+                    else if constexpr (is_specialization_v<OutputType, std::optional>)
+                        return mxIsEmpty(inp_) ? OutputType() : OutputType(getValue<typename OutputType::value_type>(inp_, nullptr));
+                    else if constexpr (Chrono<OutputType>)
+                        return chronoTraits<OutputType>::fromCount(*static_cast<const typename chronoTraits<OutputType>::rep*>(mxGetData(inp_)));
+                    else if constexpr (std::is_same_v<OutputType, std::monostate>)
+                        return OutputType{};
                     else
                         return *static_cast<OutputType*>(mxGetData(inp_));
                 }
@@ -399,6 +1209,342 @@ namespace mxTypes
         }
     }
 
+    namespace detail
+    {
+        // whether T is a std::variant, or contains one as the element of a container or std::optional
+        template <typename T>
+        constexpr bool hasVariant()
+        {
+            if constexpr (is_specialization_v<T, std::variant>)
+                return true;
+            else if constexpr (is_specialization_v<T, std::optional> || (Container<T> && !std::is_same_v<T, std::string>))
+                return hasVariant<typename T::value_type>();
+            else
+                return false;
+        }
+        // whether T is a std::variant with a std::monostate alternative, which is selected by an empty input
+        template <typename T>
+        inline constexpr bool hasMonostate = false;
+        template <typename... Ts>
+        inline constexpr bool hasMonostate<std::variant<Ts...>> = (std::is_same_v<Ts, std::monostate> || ...);
+
+        // check and convert in one go, nullopt if the input is not accepted. Equivalent to checkInput followed
+        // by getValue, but the alternative of a std::variant (also as element of a cell array or std::optional)
+        // is determined only once, so the checks of its candidates, which may recurse into cell arrays, are not
+        // repeated during conversion
+        template <typename OutputType>
+        std::optional<OutputType> tryGetValue(const mxArray* inp_)
+        {
+            if constexpr (is_specialization_v<OutputType, std::variant>)
+                return variantInfo<OutputType>::tryGet(inp_);
+            else if constexpr (hasVariant<OutputType>() && (is_specialization_v<OutputType, std::optional> || Container<OutputType>))
+            {
+                // NB: as in checkInput
+                if (mxIsComplex(inp_) || mxIsSparse(inp_))
+                    return std::nullopt;
+                if constexpr (is_specialization_v<OutputType, std::optional>)
+                {
+                    if (mxIsEmpty(inp_))
+                        return std::optional<OutputType>(std::in_place);
+                    if (auto v = tryGetValue<typename OutputType::value_type>(inp_))
+                        return std::optional<OutputType>(std::in_place, std::move(*v));
+                    return std::nullopt;
+                }
+                else
+                {
+                    if (mxIsCell(inp_))
+                    {
+                        const auto nElem = static_cast<mwIndex>(mxGetNumberOfElements(inp_));
+                        OutputType out;
+                        if constexpr (requires { out.reserve(nElem); })
+                            out.reserve(nElem);
+                        for (mwIndex i = 0; i < nElem; i++)
+                        {
+                            auto v = tryGetValue<typename OutputType::value_type>(mxGetCell(inp_, i));
+                            if (!v)
+                                return std::nullopt;
+                            out.emplace_back(std::move(*v));
+                        }
+                        return out;
+                    }
+                    // other encodings, e.g. Dense
+                    if (!checkInput<OutputType>(inp_, nullptr))
+                        return std::nullopt;
+                    return getValue<OutputType>(inp_, nullptr);
+                }
+            }
+            else
+            {
+                if (!checkInput<OutputType>(inp_, nullptr))
+                    return std::nullopt;
+                return getValue<OutputType>(inp_, nullptr);
+            }
+        }
+    }
+
+    //// value constraints, checked by FromMatlab(..., constraints...) (see below). A constraint has a
+    //// requirement() (completing "argument must ...") and either a bool ok(const mxArray*), checked on
+    //// the input array before its data is extracted, or a bool ok(const V* data, size_t i) that checks
+    //// element i. The latter is evaluated during extraction, so should be branch-free and cheap
+    namespace detail
+    {
+        template <typename A, typename B>
+        constexpr bool lessEqual(A a_, B b_)
+        {
+            if constexpr (std::is_integral_v<A> && std::is_integral_v<B> && !std::is_same_v<A, bool> && !std::is_same_v<B, bool>)
+                return std::cmp_less_equal(a_, b_);
+            else
+                return a_ <= b_;
+        }
+
+        template <typename V>
+        std::string valueToString(V v_)
+        {
+            if constexpr (std::is_floating_point_v<V>)
+            {
+                if (std::isnan(v_))
+                    return "NaN";
+                if (std::isinf(v_))
+                    return v_ > 0 ? "Inf" : "-Inf";
+                std::array<char, 32> buf;
+                const auto res = std::to_chars(buf.data(), buf.data() + buf.size(), v_);
+                return { buf.data(), res.ptr };
+            }
+            else
+                return std::to_string(v_);
+        }
+    }
+
+    // all elements finite (not NaN or Inf). Always satisfied by integers
+    struct Finite
+    {
+        std::string requirement() const { return "be finite"; }
+        template <typename V>
+        bool ok(const V* d_, size_t i_) const
+        {
+            if constexpr (std::is_floating_point_v<V>)
+                return d_[i_] - d_[i_] == 0;    // NB: NaN for NaN and Inf inputs. Unlike std::isfinite, this vectorises
+            else
+                return true;
+        }
+    };
+
+    // all elements in [lo, hi]
+    template <typename T>
+    struct InRange
+    {
+        T lo;
+        T hi;
+        std::string requirement() const { return "be in the range [" + detail::valueToString(lo) + ", " + detail::valueToString(hi) + "]"; }
+        template <typename V>
+        bool ok(const V* d_, size_t i_) const { return detail::lessEqual(lo, d_[i_]) & detail::lessEqual(d_[i_], hi); }
+    };
+    template <typename T>
+    InRange(T, T) -> InRange<T>;
+
+    // elements in non-decreasing order, or strictly increasing if strict
+    struct Sorted
+    {
+        static constexpr bool pairwise = true;      // ok() compares element i to element i-1
+        bool strict = false;
+        std::string requirement() const { return strict ? "be strictly increasing" : "be sorted in non-decreasing order"; }
+        template <typename V>
+        bool ok(const V* d_, size_t i_) const { return strict ? d_[i_ - 1] < d_[i_] : d_[i_ - 1] <= d_[i_]; }
+    };
+
+    // number of elements
+    struct Length
+    {
+        size_t n;
+        std::string requirement() const { return "have " + std::to_string(n) + (n == 1 ? " element" : " elements"); }
+        bool ok(const mxArray* inp_) const { return mxGetNumberOfElements(inp_) == n; }
+    };
+
+    // 2D array of the given size, any number of rows or columns if Shape::any
+    struct Shape
+    {
+        static constexpr size_t any = static_cast<size_t>(-1);
+        size_t rows = any;
+        size_t cols = any;
+        std::string requirement() const { return "be a " + (rows == any ? std::string("M") : std::to_string(rows)) + "x" + (cols == any ? std::string("N") : std::to_string(cols)) + " array"; }
+        bool ok(const mxArray* inp_) const { return mxGetNumberOfDimensions(inp_) == 2 && (rows == any || mxGetM(inp_) == rows) && (cols == any || mxGetN(inp_) == cols); }
+    };
+
+    template <typename C>
+    concept InputConstraint = requires (const C c_) { { c_.requirement() } -> std::convertible_to<std::string>; };
+
+    namespace detail
+    {
+        // numeric scalars and containers of numbers
+        template <typename T>
+        concept ConstrainableOutput = std::is_arithmetic_v<T> || (Container<T> && !BitContainer<T> && !std::is_same_v<T, std::string> && std::is_arithmetic_v<typename T::value_type>);
+
+        template <typename C>
+        constexpr bool isArrayConstraint = requires (const C c_, const mxArray* inp_) { { c_.ok(inp_) } -> std::convertible_to<bool>; };
+        template <typename C>
+        constexpr bool isPairwiseConstraint = requires { requires C::pairwise; };
+
+        // whether element i_ satisfies constraint c_. Pairwise constraints are trivially satisfied by the first element
+        template <bool First, typename V, typename C>
+        bool elementOk(const C& c_, const V* d_, size_t i_)
+        {
+            if constexpr (isArrayConstraint<C> || (First && isPairwiseConstraint<C>))
+                return true;
+            else
+                return c_.ok(d_, i_);
+        }
+
+        // whether elements [b_, e_) of d_ satisfy all constraints. NB: no early out, so that the loop vectorises
+        template <typename V, typename... Cs>
+        bool elementsOk(const V* d_, size_t b_, size_t e_, const Cs&... cs_)
+        {
+            if constexpr ((isArrayConstraint<Cs> && ...))
+                return true;
+            else
+            {
+                unsigned bad = 0;
+                size_t i = b_;
+                if (i == 0 && e_ > 0)
+                {
+                    bad |= !(elementOk<true>(cs_, d_, 0) & ...);
+                    i = 1;
+                }
+                for (; i < e_; i++)
+                    bad |= !(elementOk<false>(cs_, d_, i) & ...);
+                return !bad;
+            }
+        }
+
+        [[noreturn]] MEX_INPUT_GETTER_COLD inline void throwConstraintError(std::string_view funcID_, size_t idx_, size_t offset_, bool isOptional_, std::string_view requirement_, std::string_view detail_)
+        {
+            std::string out;
+            out.reserve(100);
+            out += "SWAG::";
+            if (!funcID_.empty())
+            {
+                out += funcID_;
+                out += ": ";
+            }
+            if (isOptional_)
+                out += "Optional ";
+            out += NumberToOrdinal(idx_ - offset_ + 1) + " argument must ";
+            out += requirement_;
+            out += ". ";
+            out += detail_;
+            throw out;
+        }
+
+        template <typename... Cs>
+        void checkArrayConstraints(const mxArray* inp_, std::string_view funcID_, size_t idx_, size_t offset_, bool isOptional_, const Cs&... cs_)
+        {
+            auto check = [&]<typename C>(const C& c_)
+            {
+                if constexpr (isArrayConstraint<C>)
+                {
+                    if (!c_.ok(inp_))
+                    {
+                        std::string dims;
+                        const auto numDim = mxGetNumberOfDimensions(inp_);
+                        for (mwSize i = 0; i < numDim; ++i)
+                            dims += (i ? "x" : "") + std::to_string(mxGetDimensions(inp_)[i]);
+                        throwConstraintError(funcID_, idx_, offset_, isOptional_, c_.requirement(), "The provided input argument was a " + dims + " " + mxGetClassName(inp_) + ".");
+                    }
+                }
+            };
+            (check(cs_), ...);
+        }
+
+        // called when elementsOk(d_, b_, e_, cs_...) failed: finds and reports the first offending element
+        template <typename V, typename... Cs>
+        [[noreturn]] MEX_INPUT_GETTER_COLD void throwElementError(const V* d_, size_t n_, size_t b_, size_t e_, std::string_view funcID_, size_t idx_, size_t offset_, bool isOptional_, const Cs&... cs_)
+        {
+            for (size_t i = b_; i < e_; i++)
+            {
+                std::string requirement, detail;
+                auto check = [&]<typename C>(const C& c_)
+                {
+                    if (!requirement.empty() || (i == 0 ? elementOk<true>(c_, d_, i) : elementOk<false>(c_, d_, i)))
+                        return;
+                    requirement = c_.requirement();
+                    if (n_ == 1)
+                        detail = "The provided value was " + valueToString(d_[i]) + ".";
+                    else
+                    {
+                        detail = "Element " + std::to_string(i + 1) + " is " + valueToString(d_[i]);
+                        if constexpr (isPairwiseConstraint<C>)
+                            detail += ", element " + std::to_string(i) + " is " + valueToString(d_[i - 1]);
+                        detail += ".";
+                    }
+                };
+                (check(cs_), ...);
+                if (!requirement.empty())
+                    throwConstraintError(funcID_, idx_, offset_, isOptional_, requirement, detail);
+            }
+            throwConstraintError(funcID_, idx_, offset_, isOptional_, "satisfy its constraints", "");     // not reached
+        }
+
+        template <typename V, typename... Cs>
+        void checkElements(const V* d_, size_t n_, std::string_view funcID_, size_t idx_, size_t offset_, bool isOptional_, const Cs&... cs_)
+        {
+            if (!elementsOk(d_, 0, n_, cs_...))
+                throwElementError(d_, n_, 0, n_, funcID_, idx_, offset_, isOptional_, cs_...);
+        }
+
+        // extract value, checking element constraints on the fly. Input has already passed checkInput<OutputType>()
+        template <typename OutputType, typename... Cs>
+        OutputType getConstrainedValue(const mxArray* inp_, std::string_view funcID_, size_t idx_, size_t offset_, bool isOptional_, const Cs&... cs_)
+        {
+            if constexpr (std::is_arithmetic_v<OutputType>)
+            {
+                const auto out = getValue<OutputType>(inp_, nullptr);
+                checkElements(&out, 1, funcID_, idx_, offset_, isOptional_, cs_...);
+                return out;
+            }
+            else
+            {
+                using V = typename OutputType::value_type;
+                if (mxIsCell(inp_))
+                {
+                    // cell array of scalars, check the extracted values
+                    auto out = getValue<OutputType>(inp_, nullptr);
+                    if constexpr (std::ranges::contiguous_range<OutputType>)
+                        checkElements(std::ranges::data(out), out.size(), funcID_, idx_, offset_, isOptional_, cs_...);
+                    else
+                    {
+                        ArenaScope scratchScope;
+                        const std::pmr::vector<V> values(out.begin(), out.end(), Scratch());
+                        checkElements(values.data(), values.size(), funcID_, idx_, offset_, isOptional_, cs_...);
+                    }
+                    return out;
+                }
+
+                const auto data  = static_cast<const V*>(mxGetData(inp_));
+                const auto numel = mxGetNumberOfElements(inp_);
+                if constexpr (requires (OutputType o_) { o_.insert(o_.end(), data, data); })
+                {
+                    // check a block of elements, then append it while it is still in cache
+                    constexpr size_t blockSize = 2048;
+                    OutputType out;
+                    if constexpr (requires (OutputType o_) { o_.reserve(numel); })
+                        out.reserve(numel);
+                    for (size_t b = 0; b < numel; b += blockSize)
+                    {
+                        const auto e = std::min(b + blockSize, numel);
+                        if (!elementsOk(data, b, e, cs_...))
+                            throwElementError(data, numel, b, e, funcID_, idx_, offset_, isOptional_, cs_...);
+                        out.insert(out.end(), data + b, data + e);
+                    }
+                    return out;
+                }
+                else
+                {
+                    checkElements(data, numel, funcID_, idx_, offset_, isOptional_, cs_...);
+                    return OutputType(data, data + numel);
+                }
+            }
+        }
+    }
+
     // returns T of std::optional<T> if std::optional, else just returns provided type
     template <typename T>
     struct unwrapOptional
@@ -416,6 +1562,7 @@ namespace mxTypes
     // for optional input arguments, use std::optional<T> as return type,
     // for required arguments just use any other T
     template <typename OutputType, typename Converter = std::nullptr_t>
+    requires (!InputConstraint<Converter> && !ChronoEncoding<Converter>)
     OutputType FromMatlab(int nrhs, const mxArray* prhs[], size_t idx_, std::string_view funcID_, size_t offset_, Converter conv_ = nullptr)
     {
         // unwrap std::optional to get at desired type
@@ -425,11 +1572,16 @@ namespace mxTypes
         // check converter, if provided
         if constexpr (!std::is_same_v<Converter, std::nullptr_t>)
         {
-            using traits = invocable_traits::get<Converter>;
-            constexpr bool hasError = traits::error != invocable_traits::Error::None;
-            invocable_traits::issue_error<traits::error>();
-            static_assert(hasError || traits::arity == 1, "A conversion function, if provided, must be unary.");
-            static_assert(hasError || std::is_convertible_v<typename traits::invoke_result_t, UnwrappedOutputType>, "The conversion function's result type cannot be converted to the requested output type.");
+            using traits = detail::converterTraits<Converter>;
+            if constexpr (!traits::isFastPath)
+            {
+                // full checks, with diagnostics
+                using fullTraits = typename traits::traits;
+                constexpr bool hasError = fullTraits::error != invocable_traits::Error::None;
+                invocable_traits::issue_error<fullTraits::error>();
+                static_assert(hasError || fullTraits::arity == 1, "A conversion function, if provided, must be unary.");
+            }
+            static_assert(!traits::ok || std::is_convertible_v<typename traits::result_t, UnwrappedOutputType> || std::is_convertible_v<typename traits::result_t, detail::converterOutput_t<UnwrappedOutputType>>, "The conversion function's result type cannot be converted to the requested output type.");
         }
 
         // check element exists and is not empty
@@ -437,12 +1589,176 @@ namespace mxTypes
         if constexpr (outputIsOptional)
             if (!haveElement)
                 return std::nullopt;
+        // a provided empty argument selects the std::monostate alternative of a std::variant
+        if constexpr (!outputIsOptional && detail::hasMonostate<UnwrappedOutputType>)
+            if (idx_ < static_cast<unsigned int>(nrhs) && !haveElement)
+                return UnwrappedOutputType(std::monostate{});
 
-        // see if element passes checks. If not, thats an error for an optional value
         auto inp = prhs[idx_];
-        if (!haveElement || !detail::checkInput<UnwrappedOutputType>(inp, conv_))
+        if constexpr (std::is_same_v<Converter, std::nullptr_t> && detail::hasVariant<UnwrappedOutputType>())
+        {
+            // determine the alternatives of std::variants only once, see tryGetValue
+            if (haveElement)
+                if (auto out = detail::tryGetValue<UnwrappedOutputType>(inp))
+                    return std::move(*out);
             detail::buildAndThrowError<UnwrappedOutputType>(funcID_, idx_, offset_, nrhs, prhs, outputIsOptional, conv_);
+        }
+        else
+        {
+            // see if element passes checks. If not, thats an error for an optional value
+            if (!haveElement || !detail::checkInput<UnwrappedOutputType>(inp, conv_))
+                detail::buildAndThrowError<UnwrappedOutputType>(funcID_, idx_, offset_, nrhs, prhs, outputIsOptional, conv_);
 
-        return detail::getValue<UnwrappedOutputType>(inp, conv_);
+            return detail::getValue<UnwrappedOutputType>(inp, conv_);
+        }
     }
-}
\ No newline at end of file
+
+    // as above, additionally checking that the value satisfies the given constraints (Finite, InRange,
+    // Sorted, Length, Shape, or user-defined, see above), e.g.:
+    // auto edges = FromMatlab<std::vector<double>>(nrhs, prhs, 1, "myFunc", 1, Finite{}, Sorted{ .strict = true });
+    // For numeric scalars and arrays only. Element constraints are checked block by block while the data
+    // is copied, so no separate pass over the data is needed. A violation throws an error naming the
+    // first offending element
+    template <typename OutputType, InputConstraint... Constraints>
+    requires (sizeof...(Constraints) > 0)
+    OutputType FromMatlab(int nrhs, const mxArray* prhs[], size_t idx_, std::string_view funcID_, size_t offset_, const Constraints&... constraints_)
+    {
+        bool constexpr outputIsOptional = is_specialization_v<OutputType, std::optional>;
+        using UnwrappedOutputType = typename unwrapOptional<OutputType>::type;
+        static_assert(detail::ConstrainableOutput<UnwrappedOutputType>, "Constraints can only be applied to numeric scalars and containers of numbers.");
+
+        const bool haveElement = idx_ < static_cast<unsigned int>(nrhs) && !mxIsEmpty(prhs[idx_]);
+        if constexpr (outputIsOptional)
+            if (!haveElement)
+                return std::nullopt;
+
+        auto inp = prhs[idx_];
+        if (!haveElement || !detail::checkInput<UnwrappedOutputType>(inp, nullptr))
+            detail::buildAndThrowError<UnwrappedOutputType>(funcID_, idx_, offset_, nrhs, prhs, outputIsOptional, nullptr);
+        detail::checkArrayConstraints(inp, funcID_, idx_, offset_, outputIsOptional, constraints_...);
+
+        return detail::getConstrainedValue<UnwrappedOutputType>(inp, funcID_, idx_, offset_, outputIsOptional, constraints_...);
+    }
+
+    // std::chrono durations and time points, or containers of them, in the given encoding (see Ticks, Seconds,
+    // PosixTime and Datenum), e.g.:
+    // auto t = FromMatlab<std::vector<std::chrono::sys_time<std::chrono::microseconds>>>(nrhs, prhs, 1, "myFunc", 1, Datenum{});
+    // Ticks takes an array of the representation type, the other encodings a double array, which is converted
+    // with a single vectorisable pass (values are rounded to the nearest tick). NaN (NaT), Inf and values
+    // beyond the range of the representation type are an error, naming the first such element
+    template <typename OutputType, ChronoEncoding E>
+    OutputType FromMatlab(int nrhs, const mxArray* prhs[], size_t idx_, std::string_view funcID_, size_t offset_, E)
+    {
+        if constexpr (std::is_same_v<E, Ticks>)
+            return FromMatlab<OutputType>(nrhs, prhs, idx_, funcID_, offset_);
+        else
+        {
+            bool constexpr outputIsOptional = is_specialization_v<OutputType, std::optional>;
+            using UnwrappedOutputType = typename unwrapOptional<OutputType>::type;
+            constexpr bool isContainer = Container<UnwrappedOutputType>;
+            using V = detail::converterOutput_t<UnwrappedOutputType>;
+            static_assert(Chrono<V>, "An encoding can only be given for std::chrono durations and time points, and containers of them.");
+            using Rep = typename detail::chronoTraits<V>::rep;
+
+            const bool haveElement = idx_ < static_cast<unsigned int>(nrhs) && !mxIsEmpty(prhs[idx_]);
+            if constexpr (outputIsOptional)
+                if (!haveElement)
+                    return std::nullopt;
+
+            auto inp = prhs[idx_];
+            if (!haveElement || mxGetClassID(inp) != mxDOUBLE_CLASS || mxIsComplex(inp) || mxIsSparse(inp) || (!isContainer && !mxIsScalar(inp)))
+                detail::throwArgumentError(funcID_, idx_, offset_, nrhs, prhs, outputIsOptional, "double", isContainer ? " array" : " scalar");
+
+            const auto data  = static_cast<const double*>(mxGetData(inp));
+            const auto numel = mxGetNumberOfElements(inp);
+            // NaN (NaT), Inf, or a value beyond the range of the representation type
+            auto checkConverted = [&](size_t iBad_)
+            {
+                if (iBad_ == numel)
+                    return;
+                std::string requirement = isContainer ? "be a double array of finite values in the range of " : "be a finite double scalar in the range of ";
+                requirement += detail::correspondingMatlabTypeString_v<Rep, std::nullptr_t>;
+                requirement += " tick counts";
+                detail::throwConstraintError(funcID_, idx_, offset_, outputIsOptional, requirement,
+                    (numel == 1 ? "The provided value was " : "Element " + std::to_string(iBad_ + 1) + " is ") + detail::valueToString(data[iBad_]) + ".");
+            };
+            if constexpr (isContainer)
+            {
+                ArenaScope scratchScope;
+                std::pmr::vector<Rep> reps(numel, Scratch());
+                checkConverted(scale_offset::invert(data, numel, E::template invScale<V>(), E::template offset<V>(), reps.data()));
+                return detail::getValue_impl_chrono<UnwrappedOutputType>(reps.data(), numel);
+            }
+            else
+            {
+                Rep rep;
+                checkConverted(scale_offset::invert(data, 1, E::template invScale<V>(), E::template offset<V>(), &rep));
+                return detail::chronoTraits<V>::fromCount(rep);
+            }
+        }
+    }
+
+    // parse all input arguments in one go, e.g.:
+    // auto [a, b, c] = ParseArgs<int, std::optional<double>, std::vector<float>>(nrhs, prhs, "myFunc", 1);
+    // Types are as for FromMatlab, the i-th type is read from prhs[offset_+i]. The number of provided
+    // arguments is checked once up front: all required (non-std::optional) arguments must be present,
+    // and no more arguments than types may be provided
+    template <typename... OutputTypes>
+    std::tuple<OutputTypes...> ParseArgs(int nrhs, const mxArray* prhs[], std::string_view funcID_, size_t offset_ = 0)
+    {
+        constexpr size_t nArg = sizeof...(OutputTypes);
+        constexpr std::array<bool, nArg> isOptional = { is_specialization_v<OutputTypes, std::optional>... };
+        constexpr std::array<std::string_view, nArg> typeStrs     = { detail::correspondingMatlabTypeString_v<typename unwrapOptional<OutputTypes>::type, std::nullptr_t>... };
+        constexpr std::array<std::string_view, nArg> typeSuffixes = { detail::argumentTypeSuffix<typename unwrapOptional<OutputTypes>::type>()... };
+        const auto nProvided = std::max(nrhs - static_cast<int>(offset_), 0);
+
+        // check all required arguments are provided. If not, report the first missing one
+        for (size_t i = static_cast<size_t>(nProvided); i < nArg; i++)
+        {
+            if (isOptional[i])
+                continue;
+            detail::throwArgumentError(funcID_, offset_ + i, offset_, nrhs, prhs, false, typeStrs[i], typeSuffixes[i]);
+        }
+        // and that not too many are provided
+        if (static_cast<size_t>(nProvided) > nArg)
+            detail::throwTooManyArguments(funcID_, nArg, static_cast<size_t>(nProvided));
+
+        // NB: braced initialization guarantees arguments are parsed in order
+        return [&] <size_t... Is>(std::index_sequence<Is...>)
+        {
+            return std::tuple<OutputTypes...>{ FromMatlab<OutputTypes>(nrhs, prhs, offset_ + Is, funcID_, offset_)... };
+        }(std::index_sequence_for<OutputTypes...>{});
+    }
+}
+// Optional explicit instantiation of FromMatlab for commonly used argument types, to avoid
+// instantiating (and compiling) them anew in every translation unit. To use, define
+// MEX_INPUT_GETTER_EXTERN_COMMON for all translation units (e.g. on the compiler command line), and
+// additionally define MEX_INPUT_GETTER_INSTANTIATE_COMMON in exactly one of them. Like any translation
+// unit using FromMatlab, that one must include mex_type_utils.h (before this header). See
+// tests/extern_common_compile.sh for measuring the effect on compile time and object size.
+#define MEX_INPUT_GETTER_COMMON_TYPES(X) \
+    X(bool) X(double) X(float) \
+    X(int8_t) X(int16_t) X(int32_t) X(int64_t) \
+    X(uint8_t) X(uint16_t) X(uint32_t) X(uint64_t) \
+    X(std::string) \
+    X(std::vector<double>) X(std::vector<float>) X(std::vector<int32_t>) X(std::vector<int64_t>) X(std::vector<uint64_t>) \
+    X(std::vector<std::string>) \
+    X(std::optional<bool>) X(std::optional<double>) X(std::optional<int32_t>) X(std::optional<int64_t>) X(std::optional<uint64_t>) \
+    X(std::optional<std::string>)
+
+#if defined(MEX_INPUT_GETTER_EXTERN_COMMON)
+#   define MEX_INPUT_GETTER_EXTERN(T) extern template T mxTypes::FromMatlab<T, std::nullptr_t>(int, const mxArray*[], size_t, std::string_view, size_t, std::nullptr_t);
+MEX_INPUT_GETTER_COMMON_TYPES(MEX_INPUT_GETTER_EXTERN)
+#   undef MEX_INPUT_GETTER_EXTERN
+#endif
+#if defined(MEX_INPUT_GETTER_INSTANTIATE_COMMON)
+namespace mxTypes::detail
+{
+    template <typename T>
+    concept completeType = requires { sizeof(T); };
+}
+static_assert(mxTypes::detail::completeType<mxTypes::typeToMxClass<double>>, "MEX_INPUT_GETTER_INSTANTIATE_COMMON: include mex_type_utils.h before mex_input_getter.h");
+#   define MEX_INPUT_GETTER_INSTANTIATE(T) template T mxTypes::FromMatlab<T, std::nullptr_t>(int, const mxArray*[], size_t, std::string_view, size_t, std::nullptr_t);
+MEX_INPUT_GETTER_COMMON_TYPES(MEX_INPUT_GETTER_INSTANTIATE)
+#   undef MEX_INPUT_GETTER_INSTANTIATE
+#endif
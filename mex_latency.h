@@ -0,0 +1,200 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "include_matlab.h"
+
+// Low-overhead latency instrumentation for mex entry points and command handlers. Latencies are
+// recorded into fixed log-scale histograms: four buckets per power of two, from 1 ns up to 2^45 ns
+// (~9.8 hours, larger values are put in the last bucket), i.e. a relative resolution of at most 25%.
+// Recording is lock-free (relaxed atomic increments) and allocation-free. Use ToMatlab() to get a
+// MATLAB struct with the recorded data.
+//
+// Example of instrumenting a mex function by hand (Dispatcher can also do this, see
+// Dispatcher::recordLatencies()):
+// static mxTypes::CommandLatencies stats;
+// void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+// {
+//     mxTypes::PhaseTimer timer(&stats);
+//     auto [a, b] = mxTypes::ParseArgs<int32_t, double>(nrhs, prhs, "func");
+//     timer.lap(mxTypes::Phase::Parse);
+//     auto result = process(a, b);
+//     timer.lap(mxTypes::Phase::Handler);
+//     plhs[0] = mxTypes::ToMatlab(result);
+//     timer.lap(mxTypes::Phase::Marshal);
+// }
+namespace mxTypes
+{
+    class LatencyHistogram
+    {
+    public:
+        static constexpr size_t subBucketBits = 2;
+        static constexpr size_t nSubBucket    = size_t{ 1 } << subBucketBits;
+        static constexpr size_t maxExponent   = 44;
+        static constexpr size_t nBucket       = nSubBucket * maxExponent;
+
+        // index of bucket containing given latency
+        static constexpr size_t bucketIndex(uint64_t ns_)
+        {
+            if (ns_ < nSubBucket)
+                return static_cast<size_t>(ns_);
+            const size_t e   = static_cast<size_t>(std::bit_width(ns_)) - 1;       // >= subBucketBits
+            const size_t sub = static_cast<size_t>(ns_ >> (e - subBucketBits)) & (nSubBucket - 1);
+            const size_t idx = nSubBucket * (e - subBucketBits + 1) + sub;
+            return idx < nBucket ? idx : nBucket - 1;
+        }
+        // lower edge of bucket, in ns
+        static constexpr uint64_t bucketLowerEdge(size_t idx_)
+        {
+            if (idx_ < nSubBucket)
+                return idx_;
+            const size_t e = idx_ / nSubBucket + subBucketBits - 1;
+            return (nSubBucket + idx_ % nSubBucket) << (e - subBucketBits);
+        }
+
+        void record(uint64_t ns_)
+        {
+            _counts[bucketIndex(ns_)].fetch_add(1, std::memory_order_relaxed);
+            _count.fetch_add(1, std::memory_order_relaxed);
+            _sum.fetch_add(ns_, std::memory_order_relaxed);
+            auto max = _max.load(std::memory_order_relaxed);
+            while (ns_ > max && !_max.compare_exchange_weak(max, ns_, std::memory_order_relaxed)) {}
+        }
+        void record(std::chrono::nanoseconds dur_)
+        {
+            record(static_cast<uint64_t>(dur_.count() < 0 ? 0 : dur_.count()));
+        }
+
+        void reset()
+        {
+            for (auto& c : _counts)
+                c.store(0, std::memory_order_relaxed);
+            _count.store(0, std::memory_order_relaxed);
+            _sum.store(0, std::memory_order_relaxed);
+            _max.store(0, std::memory_order_relaxed);
+        }
+
+        uint64_t count()               const { return _count.load(std::memory_order_relaxed); }
+        uint64_t sum()                 const { return _sum.load(std::memory_order_relaxed); }
+        uint64_t max()                 const { return _max.load(std::memory_order_relaxed); }
+        uint64_t bucketCount(size_t i) const { return _counts[i].load(std::memory_order_relaxed); }
+
+    private:
+        std::array<std::atomic<uint64_t>, nBucket> _counts{};
+        std::atomic<uint64_t> _count{ 0 };
+        std::atomic<uint64_t> _sum{ 0 };
+        std::atomic<uint64_t> _max{ 0 };
+    };
+
+    enum class Phase
+    {
+        Parse,      // argument parsing (FromMatlab)
+        Handler,    // the command's own work
+        Marshal,    // output conversion (ToMatlab)
+        Last
+    };
+
+    struct CommandLatencies
+    {
+        std::array<LatencyHistogram, static_cast<size_t>(Phase::Last)> phases;
+
+        LatencyHistogram&       operator[](Phase p_)       { return phases[static_cast<size_t>(p_)]; }
+        const LatencyHistogram& operator[](Phase p_) const { return phases[static_cast<size_t>(p_)]; }
+
+        void reset()
+        {
+            for (auto& p : phases)
+                p.reset();
+        }
+    };
+
+    // records time elapsed since construction or previous lap into the histogram of a phase.
+    // Does nothing when constructed with a nullptr, so instrumentation can be switched on and off at runtime
+    class PhaseTimer
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        explicit PhaseTimer(CommandLatencies* stats_) : _stats(stats_)
+        {
+            if (_stats)
+                _last = clock::now();
+        }
+
+        void lap(Phase p_)
+        {
+            if (!_stats)
+                return;
+            const auto now = clock::now();
+            (*_stats)[p_].record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - _last));
+            _last = now;
+        }
+
+    private:
+        CommandLatencies*  _stats;
+        clock::time_point  _last;
+    };
+
+    // records time between construction and destruction into a histogram
+    class ScopedLatency
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        explicit ScopedLatency(LatencyHistogram& hist_) : _hist(hist_), _start(clock::now()) {}
+        ~ScopedLatency()
+        {
+            _hist.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _start));
+        }
+
+    private:
+        LatencyHistogram&  _hist;
+        clock::time_point  _start;
+    };
+
+    // struct with fields count, total_ns, max_ns, and bin_edges_ns (lower edge of each bin) and
+    // bin_counts, up to and including the last non-empty bin
+    inline mxArray* ToMatlab(const LatencyHistogram& hist_)
+    {
+        size_t nBin = 0;
+        for (size_t i = 0; i < LatencyHistogram::nBucket; i++)
+            if (hist_.bucketCount(i))
+                nBin = i + 1;
+
+        const char* fieldNames[] = { "count", "total_ns", "max_ns", "bin_edges_ns", "bin_counts" };
+        mxArray* out = mxCreateStructMatrix(1, 1, 5, fieldNames);
+        const uint64_t scalars[] = { hist_.count(), hist_.sum(), hist_.max() };
+        for (int f = 0; f < 3; f++)
+        {
+            mxArray* s = mxCreateUninitNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+            *static_cast<uint64_t*>(mxGetData(s)) = scalars[f];
+            mxSetFieldByNumber(out, 0, f, s);
+        }
+        mxArray* edges  = mxCreateUninitNumericMatrix(nBin, 1, mxUINT64_CLASS, mxREAL);
+        mxArray* counts = mxCreateUninitNumericMatrix(nBin, 1, mxUINT64_CLASS, mxREAL);
+        auto e = static_cast<uint64_t*>(mxGetData(edges));
+        auto c = static_cast<uint64_t*>(mxGetData(counts));
+        for (size_t i = 0; i < nBin; i++)
+        {
+            e[i] = LatencyHistogram::bucketLowerEdge(i);
+            c[i] = hist_.bucketCount(i);
+        }
+        mxSetFieldByNumber(out, 0, 3, edges);
+        mxSetFieldByNumber(out, 0, 4, counts);
+        return out;
+    }
+
+    // struct with fields parse, handler and marshal
+    inline mxArray* ToMatlab(const CommandLatencies& stats_)
+    {
+        const char* fieldNames[] = { "parse", "handler", "marshal" };
+        mxArray* out = mxCreateStructMatrix(1, 1, 3, fieldNames);
+        for (int f = 0; f < 3; f++)
+            mxSetFieldByNumber(out, 0, f, ToMatlab(stats_.phases[f]));
+        return out;
+    }
+}
\ No newline at end of file
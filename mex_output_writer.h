@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "mex_type_utils.h"
+#include "is_specialization_trait.h"
+
+// writing of a mex function's outputs, converting only those the caller requested. MATLAB callers often
+// only use the first output of a function returning several, so converting (and computing) the others
+// would be wasted work. Each output is a value, which is converted with ToMatlab(), an mxArray*, which is
+// used as is, or a Lazy() thunk, which is only invoked (and its result converted) when the output is
+// requested:
+//
+// void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+// {
+//     ...
+//     mxTypes::OutputWriter(nlhs, plhs, "myMex")(std::move(samples), mxTypes::Lazy([&] { return diagnostics(samples); }));
+// }
+//
+// Output 1 is always written, as it goes into ans when no outputs are requested. The Dispatcher (see
+// mex_dispatcher.h) uses this for commands returning a std::tuple, so commands can return Lazy() outputs.
+// Errors throw a std::string.
+namespace mxTypes
+{
+    template <typename F>
+    struct LazyOutput
+    {
+        F thunk;
+    };
+    // output that is computed by invoking thunk_ only when it is requested
+    template <typename F>
+    LazyOutput<std::decay_t<F>> Lazy(F&& thunk_)
+    {
+        return { std::forward<F>(thunk_) };
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        mxArray* toOutput(T&& out_)
+        {
+            using D = std::decay_t<T>;
+            if constexpr (is_specialization_v<D, LazyOutput>)
+                return toOutput(std::invoke(std::forward<T>(out_).thunk));
+            else if constexpr (std::is_same_v<D, mxArray*>)
+                return out_;
+            else
+                return ToMatlab(std::forward<T>(out_));
+        }
+    }
+
+    class OutputWriter
+    {
+    public:
+        OutputWriter(int nlhs_, mxArray* plhs_[], std::string_view funcID_ = {}) : _nlhs(nlhs_), _plhs(plhs_), _funcID(funcID_) {}
+
+        // number of outputs to write (requested outputs, at least one)
+        int nRequested() const { return std::max(_nlhs, 1); }
+        bool requested(int i_) const { return i_ < nRequested(); }
+
+        // write output i_ (0-based) if it is requested
+        template <typename T>
+        OutputWriter& set(int i_, T&& out_)
+        {
+            if (requested(i_))
+                _plhs[i_] = detail::toOutput(std::forward<T>(out_));
+            return *this;
+        }
+
+        // write outputs in order, one per argument. Throws if more outputs are requested than provided
+        template <typename... Outs>
+        void operator()(Outs&&... outs_)
+        {
+            constexpr int nOut = static_cast<int>(sizeof...(Outs));
+            if (_nlhs > nOut)
+            {
+                std::string msg = "SWAG::";
+                if (!_funcID.empty())
+                    msg.append(_funcID).append(": ");
+                throw msg + "Too many output arguments. At most " + std::to_string(nOut) + (nOut == 1 ? " is" : " are") + " provided.";
+            }
+            int i = 0;
+            (set(i++, std::forward<Outs>(outs_)), ...);
+        }
+
+    private:
+        int              _nlhs;
+        mxArray**        _plhs;
+        std::string_view _funcID;
+    };
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <type_traits>
+
+#include "mex_type_utils.h"
+#include "sample_buffer.h"
+
+// conversion of records in a multi-producer sample buffer (see sample_buffer.h) to MATLAB, straight from
+// the buffer's chunks without intermediate copies. ToMatlab() consumes the converted records, making room
+// for the producers, PeekToMatlab() leaves them in the buffer
+namespace mxTypes
+{
+    namespace detail
+    {
+        template <typename T, size_t N, typename... Cols>
+        mxArray* sampleBufferToMatlab(const sample_buffer::Buffer<T, N>& buffer_, size_t nRecords_, const bool rowVector_, Cols... columns_)
+        {
+            return structOfArraysToMatlab<T>(nRecords_, rowVector_, [&](auto&& f_)
+            {
+                buffer_.forEachSegment(nRecords_, [&](std::span<const T> seg_)
+                {
+                    for (auto&& item : seg_)
+                        f_(item);
+                });
+            }, std::tuple<>{}, std::tuple{ columns_... });
+        }
+
+        template <typename T, size_t N>
+        mxArray* sampleBufferToMatlab(const sample_buffer::Buffer<T, N>& buffer_, size_t nRecords_)
+        {
+            auto   rCount = static_cast<mwSize>(nRecords_);
+            mwSize cCount = 1;
+            if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+                std::swap(rCount, cCount);
+            mxArray* out;
+            auto storage = static_cast<T*>(mxGetData(out = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<T>, mxREAL)));
+            buffer_.forEachSegment(nRecords_, [&](std::span<const T> seg_)
+            {
+                storage = std::copy(seg_.begin(), seg_.end(), storage);
+            });
+            return out;
+        }
+    }
+
+    // struct of arrays with a field per Column(name, fields...) (see FieldsToMatlab), containing at most
+    // maxRecords_ records (static_cast<size_t>(-1) for all available). The records are consumed
+    template <typename T, size_t N, typename... Cols>
+    requires (sizeof...(Cols) > 0)
+    mxArray* ToMatlab(sample_buffer::Buffer<T, N>& buffer_, size_t maxRecords_, const bool rowVector_, Cols... columns_)
+    {
+        const size_t n = buffer_.available(maxRecords_);
+        mxArray* out = detail::sampleBufferToMatlab(buffer_, n, rowVector_, columns_...);
+        buffer_.consume(n);
+        return out;
+    }
+    // same, but the records are left in the buffer
+    template <typename T, size_t N, typename... Cols>
+    requires (sizeof...(Cols) > 0)
+    mxArray* PeekToMatlab(const sample_buffer::Buffer<T, N>& buffer_, size_t maxRecords_, const bool rowVector_, Cols... columns_)
+    {
+        return detail::sampleBufferToMatlab(buffer_, buffer_.available(maxRecords_), rowVector_, columns_...);
+    }
+
+    // array with at most maxRecords_ records (default: all available), for buffers of arithmetic values.
+    // The records are consumed
+    template <typename T, size_t N>
+    requires std::is_arithmetic_v<T>
+    mxArray* ToMatlab(sample_buffer::Buffer<T, N>& buffer_, size_t maxRecords_ = static_cast<size_t>(-1))
+    {
+        const size_t n = buffer_.available(maxRecords_);
+        mxArray* out = detail::sampleBufferToMatlab(buffer_, n);
+        buffer_.consume(n);
+        return out;
+    }
+    // same, but the records are left in the buffer
+    template <typename T, size_t N>
+    requires std::is_arithmetic_v<T>
+    mxArray* PeekToMatlab(const sample_buffer::Buffer<T, N>& buffer_, size_t maxRecords_ = static_cast<size_t>(-1))
+    {
+        return detail::sampleBufferToMatlab(buffer_, buffer_.available(maxRecords_));
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#include "mex_type_utils.h"
+#include "shm_ring.h"
+
+// conversion of records in a shared memory ring (see shm_ring.h) to MATLAB, straight from the shared
+// region without intermediate copies. Converted records are consumed, making room for the producer.
+namespace mxTypes
+{
+    // struct of arrays with a field per Column(name, fields...) (see ColumnsToMatlab), containing at most
+    // maxRecords_ records (static_cast<size_t>(-1) for all available)
+    template <typename T, typename... Cols>
+    requires (sizeof...(Cols) > 0)
+    mxArray* ToMatlab(shm_ring::Ring<T>& ring_, size_t maxRecords_, const bool rowVector_, Cols... columns_)
+    {
+        const auto segs = ring_.peek(maxRecords_);
+        mxArray* out = ColumnsToMatlab(segs, rowVector_, columns_...);
+        ring_.consume(segs[0].size() + segs[1].size());
+        return out;
+    }
+
+    // array with at most maxRecords_ records (default: all available), for rings of arithmetic values
+    template <typename T>
+    requires std::is_arithmetic_v<T>
+    mxArray* ToMatlab(shm_ring::Ring<T>& ring_, size_t maxRecords_ = static_cast<size_t>(-1))
+    {
+        const auto segs = ring_.peek(maxRecords_);
+        auto   rCount = static_cast<mwSize>(segs[0].size() + segs[1].size());
+        mwSize cCount = 1;
+        if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+            std::swap(rCount, cCount);
+        mxArray* out;
+        auto storage = static_cast<T*>(mxGetData(out = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<T>, mxREAL)));
+        std::copy(segs[0].begin(), segs[0].end(), storage);
+        std::copy(segs[1].begin(), segs[1].end(), storage + segs[0].size());
+        ring_.consume(segs[0].size() + segs[1].size());
+        return out;
+    }
+}
@@ -1,9 +1,18 @@
 #pragma once
+#include <algorithm>
 #include <type_traits>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <span>
 
 #include "mex_type_utils_fwd.h"
 #include "always_false.h"
 #include "get_field_nested.h"
+#include "bit_pack.h"
+#include "mex_arena.h"
+#include "strided_gather.h"
+#include "scale_offset.h"
 
 namespace mxTypes {
     //// functionality to convert C++ types to MATLAB ClassIDs and back
@@ -36,36 +45,19 @@ namespace mxTypes {
         static constexpr bool value = false;
     };
 
-    template <mxClassID T>
-    constexpr mxClassID MxClassToType()
-    {
-        if      constexpr (T == mxDOUBLE_CLASS)
-            using type = double;
-        else if constexpr (T == mxSINGLE_CLASS)
-            using type = float;
-        else if constexpr (T == mxLOGICAL_CLASS)
-            using type = bool;
-        else if constexpr (T == mxCHAR_CLASS)
-            using type = mxChar;
-        else if constexpr (T == mxUINT64_CLASS)
-            using type = uint64_t;
-        else if constexpr (T == mxINT64_CLASS)
-            using type = int64_t;
-        else if constexpr (T == mxUINT32_CLASS)
-            using type = uint32_t;
-        else if constexpr (T == mxINT32_CLASS)
-            using type = int32_t;
-        else if constexpr (T == mxUINT16_CLASS)
-            using type = uint16_t;
-        else if constexpr (T == mxINT16_CLASS)
-            using type = int16_t;
-        else if constexpr (T == mxUINT8_CLASS)
-            using type = uint8_t;
-        else if constexpr (T == mxINT8_CLASS)
-            using type = int8_t;
-
-        return mxUNKNOWN_CLASS; // to make some compilers happy, return value is not to be used.
-    }
+    template <mxClassID T> struct mxClassToType { static_assert(always_false_nt<T>, "mxClassToType not implemented for this class"); using type = void; };
+    template <>            struct mxClassToType<mxDOUBLE_CLASS > { using type = double;   };
+    template <>            struct mxClassToType<mxSINGLE_CLASS > { using type = float;    };
+    template <>            struct mxClassToType<mxLOGICAL_CLASS> { using type = mxLogical;};
+    template <>            struct mxClassToType<mxCHAR_CLASS   > { using type = mxChar;   };
+    template <>            struct mxClassToType<mxUINT64_CLASS > { using type = uint64_t; };
+    template <>            struct mxClassToType<mxINT64_CLASS  > { using type = int64_t;  };
+    template <>            struct mxClassToType<mxUINT32_CLASS > { using type = uint32_t; };
+    template <>            struct mxClassToType<mxINT32_CLASS  > { using type = int32_t;  };
+    template <>            struct mxClassToType<mxUINT16_CLASS > { using type = uint16_t; };
+    template <>            struct mxClassToType<mxINT16_CLASS  > { using type = int16_t;  };
+    template <>            struct mxClassToType<mxUINT8_CLASS  > { using type = uint8_t;  };
+    template <>            struct mxClassToType<mxINT8_CLASS   > { using type = int8_t;   };
 
     template <mxClassID T>
     constexpr const char* mxClassToString()
@@ -110,6 +102,51 @@ namespace mxTypes {
             return "unknown";
     }
 
+    namespace detail
+    {
+        // whether name_ is a valid MATLAB identifier (variable or struct field name): a letter followed by
+        // letters, digits and underscores, at most namelengthmax (63) characters
+        constexpr bool isMatlabIdentifier(std::string_view name_)
+        {
+            constexpr auto isAlpha = [](char c_) { return (c_ >= 'a' && c_ <= 'z') || (c_ >= 'A' && c_ <= 'Z'); };
+            if (name_.empty() || name_.size() > 63 || !isAlpha(name_[0]))
+                return false;
+            return std::all_of(name_.begin() + 1, name_.end(), [&](char c_) { return isAlpha(c_) || (c_ >= '0' && c_ <= '9') || c_ == '_'; });
+        }
+
+        template <mxClassID C, typename F>
+        decltype(auto) visitNumeric(const mxArray* inp_, F&& f_)
+        {
+            using T = mxClassToType_t<C>;
+            return std::invoke(std::forward<F>(f_),
+                std::span<const T>(static_cast<const T*>(mxGetData(inp_)), mxGetNumberOfElements(inp_)),
+                std::span<const mwSize>(mxGetDimensions(inp_), mxGetNumberOfDimensions(inp_)));
+        }
+    }
+
+    template <typename F>
+    decltype(auto) VisitNumeric(const mxArray* inp_, F&& f_)
+    {
+        if (!mxIsNumeric(inp_) || mxIsComplex(inp_) || mxIsSparse(inp_))
+            throw std::string("VisitNumeric: input must be a real, non-sparse numeric array, was a ") + (mxIsComplex(inp_) ? "complex " : "") + (mxIsSparse(inp_) ? "sparse " : "") + mxGetClassName(inp_) + ".";
+
+        switch (mxGetClassID(inp_))
+        {
+            case mxDOUBLE_CLASS: return detail::visitNumeric<mxDOUBLE_CLASS>(inp_, std::forward<F>(f_));
+            case mxSINGLE_CLASS: return detail::visitNumeric<mxSINGLE_CLASS>(inp_, std::forward<F>(f_));
+            case mxUINT64_CLASS: return detail::visitNumeric<mxUINT64_CLASS>(inp_, std::forward<F>(f_));
+            case mxINT64_CLASS:  return detail::visitNumeric<mxINT64_CLASS >(inp_, std::forward<F>(f_));
+            case mxUINT32_CLASS: return detail::visitNumeric<mxUINT32_CLASS>(inp_, std::forward<F>(f_));
+            case mxINT32_CLASS:  return detail::visitNumeric<mxINT32_CLASS >(inp_, std::forward<F>(f_));
+            case mxUINT16_CLASS: return detail::visitNumeric<mxUINT16_CLASS>(inp_, std::forward<F>(f_));
+            case mxINT16_CLASS:  return detail::visitNumeric<mxINT16_CLASS >(inp_, std::forward<F>(f_));
+            case mxUINT8_CLASS:  return detail::visitNumeric<mxUINT8_CLASS >(inp_, std::forward<F>(f_));
+            case mxINT8_CLASS:   return detail::visitNumeric<mxINT8_CLASS  >(inp_, std::forward<F>(f_));
+            default:
+                throw std::string("VisitNumeric: unsupported class ") + mxGetClassName(inp_) + ".";
+        }
+    }
+
     //// converters of generic data types to MATLAB variables
     //// to simple variables
     inline mxArray* ToMatlab(std::string str_)
@@ -128,7 +165,7 @@ namespace mxTypes {
     }
 
     template<class Cont, typename... Extras>
-    requires Container<Cont>
+    requires Container<Cont> && (!Selection<std::decay_t<std::tuple_element_t<0, std::tuple<Extras..., void>>>>)
     mxArray* ToMatlab(Cont data_, Extras&&... extras_)
     {
         mxArray* temp = nullptr;
@@ -253,6 +290,262 @@ namespace mxTypes {
             return ToMatlab(*val_);
     }
 
+    namespace detail
+    {
+        inline mxArray* createLogicalVector(size_t n_)
+        {
+            auto   rCount = static_cast<mwSize>(n_);
+            mwSize cCount = 1;
+            if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+                std::swap(rCount, cCount);
+            return mxCreateLogicalMatrix(rCount, cCount);
+        }
+    }
+
+    inline mxArray* ToMatlab(const std::vector<bool>& data_)
+    {
+        mxArray* temp = detail::createLogicalVector(data_.size());
+        auto storage = static_cast<mxLogical*>(mxGetData(temp));
+#if BIT_PACK_HAVE_VECTOR_WORDS
+        // expand 8 bits at a time
+        if (!data_.empty())
+            bit_pack::unpack(bit_pack::vector_words(data_), data_.size(), storage);
+#else
+        std::copy(data_.begin(), data_.end(), storage);
+#endif
+        return temp;
+    }
+    template <size_t N>
+    mxArray* ToMatlab(const std::bitset<N>& data_)
+    {
+        mxArray* temp = detail::createLogicalVector(N);
+        auto storage = static_cast<mxLogical*>(mxGetData(temp));
+        if constexpr (N <= 64)
+        {
+            // single word
+            const uint64_t word = data_.to_ullong();
+            bit_pack::unpack(&word, N, storage);
+        }
+        else
+        {
+            // NB: std::bitset offers no access to its words
+            for (size_t i = 0; i < N; i++)
+                storage[i] = data_[i];
+        }
+        return temp;
+    }
+
+    template <RegisteredEnum E>
+    mxArray* ToMatlab(E val_)
+    {
+        using info = detail::enumInfo<E>;
+        const auto idx = info::indexOf(val_);
+        return mxCreateString(idx == info::npos ? "" : info::names[idx].data());
+    }
+
+    namespace detail
+    {
+        // smallest unsigned integer type that can hold 1-based indices into a table with N elements
+        template <size_t N>
+        using enumCode_t = std::conditional_t<(N < 0xFF), uint8_t, std::conditional_t<(N < 0xFFFF), uint16_t, uint32_t>>;
+
+        template <size_t N>
+        mxArray* enumNamesToCellstring(const std::array<std::string_view, N>& names_, const std::array<bool, N>* include_ = nullptr)
+        {
+            mwSize n = 0;
+            for (size_t i = 0; i < N; i++)
+                n += !include_ || (*include_)[i];
+            mxArray* out = mxCreateCellMatrix(n, 1);
+            for (mwIndex i = 0, j = 0; i < N; i++)
+                if (!include_ || (*include_)[i])
+                    mxSetCell(out, j++, mxCreateString(names_[i].data()));
+            return out;
+        }
+
+        template <typename Code>
+        mxArray* enumCodesStruct(const char* codesField_, const char* namesField_, mwSize nElem_, Code*& codes_)
+        {
+            auto   rCount = nElem_;
+            mwSize cCount = 1;
+            if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+                std::swap(rCount, cCount);
+            const char* fieldNames[] = { codesField_, namesField_ };
+            mxArray* out = mxCreateStructMatrix(1, 1, 2, fieldNames);
+            mxArray* codes;
+            mxSetFieldByNumber(out, 0, 0, codes = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<Code>, mxREAL));
+            codes_ = static_cast<Code*>(mxGetData(codes));
+            return out;
+        }
+    }
+
+    template<class Cont>
+    requires Container<Cont> && RegisteredEnum<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, EnumCodes)
+    {
+        using info = detail::enumInfo<typename Cont::value_type>;
+        using Code = detail::enumCode_t<info::N>;
+
+        constexpr auto code = []
+        {
+            std::array<Code, info::N + 1> out{};   // last element is for unregistered values, maps to 0
+            for (size_t i = 0; i < info::N; i++)
+                out[i] = static_cast<Code>(i + 1);
+            return out;
+        }();
+
+        Code* codes;
+        mxArray* out = detail::enumCodesStruct("codes", "names", static_cast<mwSize>(data_.size()), codes);
+        for (auto&& item : data_)
+            *codes++ = code[info::indexOf(item)];
+        mxSetFieldByNumber(out, 0, 1, detail::enumNamesToCellstring(info::names));
+        return out;
+    }
+    template<class Cont>
+    requires Container<Cont> && RegisteredEnum<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, EnumCategorical)
+    {
+        using info = detail::enumInfo<typename Cont::value_type>;
+        using Code = detail::enumCode_t<info::N>;
+
+        // first pass: see which values occur, and determine their index into the categories
+        std::array<bool, info::N> occurs{};
+        for (auto&& item : data_)
+            if (const auto idx = info::indexOf(item); idx != info::npos)
+                occurs[idx] = true;
+        std::array<Code, info::N + 1> category{};  // last element is for unregistered values, maps to 0
+        for (size_t i = 0, c = 0; i < info::N; i++)
+            if (occurs[i])
+                category[i] = static_cast<Code>(++c);
+
+        // second pass: output
+        Code* index;
+        mxArray* out = detail::enumCodesStruct("index", "categories", static_cast<mwSize>(data_.size()), index);
+        for (auto&& item : data_)
+            *index++ = category[info::indexOf(item)];
+        mxSetFieldByNumber(out, 0, 1, detail::enumNamesToCellstring(info::names, &occurs));
+        return out;
+    }
+
+    template<class Cont>
+    requires Container<Cont> && DenseElement<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, Dense)
+    {
+        using V = typename Cont::value_type;
+        using T = denseStorage_t<V>;
+        auto   rCount = static_cast<mwSize>(data_.size());
+        mwSize cCount = 1;
+        if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+            std::swap(rCount, cCount);
+
+        mxArray* temp;
+        if constexpr (DenseVariant<V>)
+        {
+            auto storage = static_cast<T*>(mxGetData(temp = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<T>, mxREAL)));
+            for (auto&& item : data_)
+                *storage++ = std::visit([](auto v_) { return static_cast<T>(v_); }, item);
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            // NaN for missing values
+            auto storage = static_cast<T*>(mxGetData(temp = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<T>, mxREAL)));
+            for (auto&& item : data_)
+                *storage++ = item ? *item : std::numeric_limits<T>::quiet_NaN();
+        }
+        else
+        {
+            // values and validity mask
+            const char* fieldNames[] = { "values", "valid" };
+            temp = mxCreateStructMatrix(1, 1, 2, fieldNames);
+            mxArray* values;
+            mxArray* valid;
+            mxSetFieldByNumber(temp, 0, 0, values = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<T>, mxREAL));
+            mxSetFieldByNumber(temp, 0, 1, valid  = mxCreateLogicalMatrix(rCount, cCount));
+            auto vStorage = static_cast<T*>(mxGetData(values));
+            auto mStorage = static_cast<mxLogical*>(mxGetData(valid));
+            for (auto&& item : data_)
+            {
+                const bool has = item.has_value();
+                *vStorage++ = has ? *item : T{};
+                *mStorage++ = has;
+            }
+        }
+        return temp;
+    }
+
+    template <Chrono T, ChronoEncoding E>
+    mxArray* ToMatlab(T val_, E encoding_)
+    {
+        return ToMatlab(encoding_(val_));
+    }
+
+    namespace detail
+    {
+        // tick counts of n_ values of type T, in encoding E. reps_ points to the tick counts of the values, out_ may
+        // alias it
+        template <Chrono T, ChronoEncoding E, typename Rep, typename Out>
+        void encodeTicks(const Rep* reps_, size_t n_, Out* out_)
+        {
+            if constexpr (std::is_same_v<E, Ticks>)
+            {
+                if (static_cast<const void*>(reps_) != static_cast<const void*>(out_))
+                    memcpy(out_, reps_, n_ * sizeof(Rep));
+            }
+            else
+                scale_offset::apply(reps_, n_, E::template scale<T>(), E::template offset<T>(), out_);
+        }
+        // n_ values of type T stored stride_ bytes apart, starting at base_, in encoding E: gather the tick counts,
+        // then encode them a block at a time
+        template <Chrono T, ChronoEncoding E, typename Out>
+        void gatherEncodeTicks(const std::byte* base_, size_t stride_, size_t n_, Out* out_)
+        {
+            using Rep = typename chronoTraits<T>::rep;
+            if constexpr (std::is_same_v<Rep, Out>)
+            {
+                // gather into the output, encode in place
+                strided_gather::gather<Rep>(base_, stride_, n_, out_);
+                encodeTicks<T, E>(out_, n_, out_);
+            }
+            else
+            {
+                constexpr size_t blockSize = 1024;
+                Rep reps[blockSize];
+                for (size_t b = 0; b < n_; b += blockSize)
+                {
+                    const auto n = std::min(blockSize, n_ - b);
+                    strided_gather::gather<Rep>(base_ + b * stride_, stride_, n, reps);
+                    encodeTicks<T, E>(reps, n, out_ + b);
+                }
+            }
+        }
+    }
+
+    template <class Cont, ChronoEncoding E>
+    requires Container<Cont> && Chrono<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, E encoding_)
+    {
+        using V   = typename Cont::value_type;
+        using Out = decltype(encoding_(std::declval<V>()));
+        auto   rCount = static_cast<mwSize>(data_.size());
+        mwSize cCount = 1;
+        if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+            std::swap(rCount, cCount);
+
+        mxArray* temp;
+        auto storage = static_cast<Out*>(mxGetData(temp = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<Out>, mxREAL)));
+        if constexpr (ContiguousStorage<Cont> && detail::chronoIsRep<V>)
+        {
+            // memcpy, or vectorised scaling, of the tick counts
+            if (!data_.empty())
+                detail::encodeTicks<V, E>(reinterpret_cast<const typename detail::chronoTraits<V>::rep*>(&*std::cbegin(data_)), data_.size(), storage);
+        }
+        else
+        {
+            for (auto&& item : data_)
+                *storage++ = encoding_(item);
+        }
+        return temp;
+    }
+
     template <template <class...> class Cont, class... Args>
     requires
         (
@@ -263,14 +556,24 @@ namespace mxTypes {
             std::is_convertible_v<typename Cont<Args...>::key_type, std::string>
     mxArray* ToMatlab(Cont<Args...> data_)
     {
-        // get all keys
-        std::vector<std::string> keys;
+        // get a vector of pointers to beginning of the keys, so we can pass it to the C API of mxCreateStructMatrix.
+        // Point directly into the keys if possible, else convert them to temporary strings first
+        using Key = typename Cont<Args...>::key_type;
+        ArenaScope scratchScope;
+        std::pmr::vector<const char*> fields(Scratch());
+        fields.reserve(data_.size());
+        std::pmr::vector<std::pmr::string> keys(Scratch());
+        if constexpr (!requires(const Key& k) { k.c_str(); } && !std::is_convertible_v<Key, const char*>)
+            keys.reserve(data_.size());
         for (auto&& [key, val]: data_)
-            keys.push_back(std::move(key));
-        // get a vector of pointers to beginning of strings, so we can pass it to the C API of mxCreateStructMatrix
-        std::vector<const char*> fields;
-        for (const auto& k: keys)
-            fields.push_back(k.c_str());
+        {
+            if constexpr (requires { key.c_str(); })
+                fields.push_back(key.c_str());
+            else if constexpr (std::is_convertible_v<Key, const char*>)
+                fields.push_back(key);
+            else
+                fields.push_back(keys.emplace_back(std::string(key)).c_str());
+        }
 
         // create the struct
         auto storage = mxCreateStructMatrix(1, 1, static_cast<int>(fields.size()), fields.data());
@@ -332,9 +635,84 @@ namespace mxTypes {
         return storage;
     }
 
+    template<class Cont>
+    requires RaggedContainer<Cont>
+    mxArray* ToMatlab(const Cont& data_, Ragged opts_)
+    {
+        mxArray* temp;
+        using V = typename Cont::value_type::value_type;
+        const auto nOuter = static_cast<mwSize>(data_.size());
+
+        // sizing pass: total number of elements, and whether all inner containers are of equal size
+        mwSize nTotal = 0;
+        const mwSize nFirst = nOuter ? static_cast<mwSize>(std::begin(data_)->size()) : 0;
+        bool isRectangular = true;
+        for (auto&& inner : data_)
+        {
+            nTotal += static_cast<mwSize>(inner.size());
+            isRectangular = isRectangular && static_cast<mwSize>(inner.size()) == nFirst;
+        }
+
+        // NB: not if the inner containers are all empty, an nOuter x 0 matrix would read back as an empty argument
+        if (opts_.denseIfRectangular && isRectangular && nOuter && nFirst)
+        {
+            // output nOuter x nInner matrix, each row containing one inner container
+            auto storage = static_cast<V*>(mxGetData(temp = mxCreateUninitNumericMatrix(nOuter, nFirst, typeToMxClass_v<V>, mxREAL)));
+            for (auto&& inner : data_)
+            {
+                auto out = storage++;
+                for (auto&& item : inner)
+                {
+                    *out = item;
+                    out += nOuter;
+                }
+            }
+            return temp;
+        }
+
+        // output ragged struct
+        auto   rCountD = nTotal;
+        auto   rCountO = nOuter + 1;
+        mwSize cCountD = 1, cCountO = 1;
+        if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+        {
+            std::swap(rCountD, cCountD);
+            std::swap(rCountO, cCountO);
+        }
+        const char* fieldNames[] = { "data", "offsets" };
+        temp = mxCreateStructMatrix(1, 1, 2, fieldNames);
+        mxArray* data;
+        mxArray* offsets;
+        mxSetFieldByNumber(temp, 0, 0, data    = mxCreateUninitNumericMatrix(rCountD, cCountD, typeToMxClass_v<V>, mxREAL));
+        mxSetFieldByNumber(temp, 0, 1, offsets = mxCreateUninitNumericMatrix(rCountO, cCountO, mxUINT64_CLASS, mxREAL));
+
+        auto storage = static_cast<V*>(mxGetData(data));
+        auto offStorage = static_cast<uint64_t*>(mxGetData(offsets));
+        uint64_t offset = 0;
+        for (auto&& inner : data_)
+        {
+            *offStorage++ = offset;
+            if constexpr (ContiguousStorage<typename Cont::value_type>)
+            {
+                if (!inner.empty())
+                    memcpy(storage + offset, &*std::begin(inner), inner.size() * sizeof(V));
+            }
+            else
+            {
+                auto out = storage + offset;
+                for (auto&& item : inner)
+                    *out++ = item;
+            }
+            offset += inner.size();
+        }
+        *offStorage = offset;
+
+        return temp;
+    }
+
     // generic ToMatlab that converts provided data through type tag dispatch
     template <class T, class U>
-    requires (!Container<T>)
+    requires (!Container<T>) && requires (T v_) { static_cast<U>(v_); }
     mxArray* ToMatlab(T val_, U)
     {
         return ToMatlab(static_cast<U>(val_));
@@ -342,6 +720,167 @@ namespace mxTypes {
 
 
     //// struct of arrays
+    namespace detail
+    {
+        // type of the field selected by the field specifications Fs on an object of type V
+        template <typename V, typename Fields>
+        struct fieldValue;
+        template <typename V, typename... Fs>
+        struct fieldValue<V, std::tuple<Fs...>>
+        {
+            using type = std::decay_t<decltype(nested_field::getWrapper(std::declval<const V&>(), std::declval<Fs>()...))>;
+        };
+        template <typename Fields>
+        struct isMemberPath;
+        template <typename... Fs>
+        struct isMemberPath<std::tuple<Fs...>> : std::bool_constant<(std::is_member_object_pointer_v<Fs> && ...)> {};
+
+        // address of the (nested) member variable selected by pointers to member variables, a trailing type tag is ignored
+        template <typename O, typename F, typename... Rest>
+        auto fieldAddress(const O& obj_, F field_, Rest... rest_)
+        {
+            if constexpr (sizeof...(Rest) == 0)
+                return &(obj_.*field_);
+            else if constexpr (sizeof...(Rest) == 1 && !(std::is_member_object_pointer_v<Rest> && ...))
+                return &(obj_.*field_);
+            else
+                return fieldAddress(obj_.*field_, rest_...);
+        }
+        // whether the field specifications Fs select a plain arithmetic member variable (optionally cast to another
+        // arithmetic type by a trailing type tag). Such a field is at the same offset in every object, and can be
+        // extracted from contiguous storage with strided loads (see strided_gather.h)
+        template <typename V, typename... Fs>
+        constexpr bool isStridedField()
+        {
+            constexpr size_t nPath = (size_t{ std::is_member_object_pointer_v<Fs> } + ... + 0);
+            if constexpr (nPath == 0 || nPath + 1 < sizeof...(Fs))
+                return false;
+            else if constexpr (!std::is_member_object_pointer_v<std::tuple_element_t<0, std::tuple<Fs...>>>)
+                return false;
+            else if constexpr (nPath < sizeof...(Fs) && (std::is_member_object_pointer_v<last<0, Fs...>> || !std::is_arithmetic_v<last<0, Fs...>>))
+                // tag is not last, or is a conversion function or enum
+                return false;
+            else
+                return std::is_arithmetic_v<std::remove_cvref_t<decltype(*fieldAddress(std::declval<const V&>(), std::declval<Fs>()...))>>;
+        }
+        // whether the field specifications Fs select a std::chrono member variable, followed by an encoding
+        template <typename V, typename... Fs>
+        constexpr bool isStridedChronoField()
+        {
+            constexpr size_t nPath = (size_t{ std::is_member_object_pointer_v<Fs> } + ... + 0);
+            if constexpr (nPath == 0 || nPath + 1 != sizeof...(Fs))
+                return false;
+            else if constexpr (!std::is_member_object_pointer_v<std::tuple_element_t<0, std::tuple<Fs...>>> || !ChronoEncoding<last<0, Fs...>>)
+                return false;
+            else
+            {
+                using T = std::remove_cvref_t<decltype(*fieldAddress(std::declval<const V&>(), std::declval<Fs>()...))>;
+                if constexpr (Chrono<T>)
+                    return chronoIsRep<T> && std::is_arithmetic_v<typename chronoTraits<T>::rep>;
+                else
+                    return false;
+            }
+        }
+
+        // struct of arrays export: a column writer creates the MATLAB array for a Column() or Nested() (out_), and
+        // returns a callable that stores the value for the i-th object in it. Path is the tuple of pointers to
+        // member variables leading from the exported object to the object the column is relative to
+        template <typename V, typename Path, typename... Fs>
+        auto makeColumnWriter(const NamedColumn<Fs...>& col_, const Path& path_, mwSize rCount_, mwSize cCount_, mxArray*& out_);
+        template <typename V, typename Path, typename P, typename C>
+        auto makeColumnWriter(const NestedColumn<P, C>& col_, const Path& path_, mwSize rCount_, mwSize cCount_, mxArray*& out_);
+
+        template <typename V, typename Path, typename Children>
+        auto makeStructWriter(const Children& children_, const Path& path_, mwSize rCount_, mwSize cCount_, mxArray*& out_)
+        {
+            return std::apply([&](const auto&... child_)
+            {
+                static_assert(sizeof...(child_) > 0, "A nested struct must have at least one field");
+                const char* fieldNames[] = { child_.name... };
+                out_ = mxCreateStructMatrix(1, 1, static_cast<int>(sizeof...(child_)), fieldNames);
+                int f = 0;
+                auto makeChild = [&](const auto& c_)
+                {
+                    mxArray* arr;
+                    auto writer = makeColumnWriter<V>(c_, path_, rCount_, cCount_, arr);
+                    mxSetFieldByNumber(out_, 0, f++, arr);
+                    return writer;
+                };
+                // NB: braced initialization guarantees fields are created in order
+                std::tuple writers{ makeChild(child_)... };
+                return [writers](const V& item_, mwIndex i_)
+                {
+                    std::apply([&](const auto&... w_) { (w_(item_, i_), ...); }, writers);
+                };
+            }, children_);
+        }
+
+        template <typename V, typename Path, typename... Fs>
+        auto makeColumnWriter(const NamedColumn<Fs...>& col_, const Path& path_, mwSize rCount_, mwSize cCount_, mxArray*& out_)
+        {
+            auto fields = std::tuple_cat(path_, col_.fields);
+            using Fields = decltype(fields);
+            using U = typename fieldValue<V, Fields>::type;
+            auto get = [fields](const V& item_)
+            {
+                return std::apply([&](auto... f_) { return nested_field::getWrapper(item_, f_...); }, fields);
+            };
+
+            if constexpr (HasFieldSchema<U> && isMemberPath<Fields>::value)
+                // struct with registered schema: recurse into it
+                return makeStructWriter<V>(fieldSchema<U>::value, fields, rCount_, cCount_, out_);
+            else if constexpr (Chrono<U>)
+            {
+                // std::chrono field without encoding: default encoding
+                using Rep = typename chronoTraits<U>::rep;
+                auto storage = static_cast<Rep*>(mxGetData(out_ = mxCreateUninitNumericMatrix(rCount_, cCount_, typeToMxClass_v<Rep>, mxREAL)));
+                return [storage, get](const V& item_, mwIndex i_)
+                {
+                    storage[i_] = Ticks{}(get(item_));
+                };
+            }
+            else if constexpr (typeNeedsMxCellStorage_v<U>)
+            {
+                out_ = mxCreateCellMatrix(rCount_, cCount_);
+                return [arr = out_, get](const V& item_, mwIndex i_)
+                {
+                    mxSetCell(arr, i_, ToMatlab(get(item_)));
+                };
+            }
+            else
+            {
+                static_assert(typeToMxClass_v<U> != mxSTRUCT_CLASS, "To export a field of struct type, register a fieldSchema for it or use Nested()");
+                auto storage = static_cast<U*>(mxGetData(out_ = mxCreateUninitNumericMatrix(rCount_, cCount_, typeToMxClass_v<U>, mxREAL)));
+                return [storage, get](const V& item_, mwIndex i_)
+                {
+                    storage[i_] = get(item_);
+                };
+            }
+        }
+
+        template <typename V, typename Path, typename P, typename C>
+        auto makeColumnWriter(const NestedColumn<P, C>& col_, const Path& path_, mwSize rCount_, mwSize cCount_, mxArray*& out_)
+        {
+            return makeStructWriter<V>(col_.children, std::tuple_cat(path_, col_.path), rCount_, cCount_, out_);
+        }
+
+        // export in a single pass: forEach_ should invoke its argument for each object, in order
+        template <typename V, typename Path, typename Children, typename ForEach>
+        mxArray* structOfArraysToMatlab(size_t nElem_, bool rowVector_, ForEach&& forEach_, const Path& path_, const Children& children_)
+        {
+            auto   rCount = static_cast<mwSize>(nElem_);
+            mwSize cCount = 1;
+            if (rowVector_)
+                std::swap(rCount, cCount);
+
+            mxArray* out;
+            auto writer = makeStructWriter<V>(children_, path_, rCount, cCount, out);
+            mwIndex i = 0;
+            forEach_([&](const V& item_) { writer(item_, i++); });
+            return out;
+        }
+    }
+
     // machinery to turn a container of objects into a single struct with an array per object field
     // default output is storage type corresponding to the type of the member variable accessed through this function, but it can be overridden through type tag dispatch (see getFieldWrapper implementation)
     template<typename Cont, typename... Fs>
@@ -356,7 +895,19 @@ namespace mxTypes {
         if (rowVector_)
             std::swap(rCount, cCount);
 
-        if constexpr (typeNeedsMxCellStorage_v<U>)
+        if constexpr (HasFieldSchema<std::decay_t<U>> && (std::is_member_object_pointer_v<Fs> && ...))
+        {
+            // field is a struct with a registered schema: output nested struct of arrays
+            temp = detail::structOfArraysToMatlab<V>(data_.size(), rowVector_, [&](auto&& f_)
+            {
+                for (auto&& item : data_)
+                    f_(item);
+            }, std::make_tuple(fields_...), fieldSchema<std::decay_t<U>>::value);
+        }
+        else if constexpr (Chrono<std::decay_t<U>>)
+            // std::chrono field without encoding: default encoding
+            temp = FieldToMatlab(data_, rowVector_, fields_..., Ticks{});
+        else if constexpr (typeNeedsMxCellStorage_v<U>)
         {
             // output cell array
             temp = mxCreateCellMatrix(rCount, cCount);
@@ -385,7 +936,20 @@ namespace mxTypes {
 
             if (data_.size())
             {
-                if constexpr (!typeDumpVectorOneAtATime_v<V>)
+                if constexpr (!typeDumpVectorOneAtATime_v<V> && ContiguousStorage<Cont> && detail::isStridedField<V, Fs...>())
+                {
+                    // plain member variable: gather straight from the objects' storage
+                    const auto field = detail::fieldAddress(*std::cbegin(data_), fields_...);
+                    using In = std::remove_cvref_t<decltype(*field)>;
+                    strided_gather::gather<In>(reinterpret_cast<const std::byte*>(field), sizeof(V), data_.size(), storage);
+                }
+                else if constexpr (!typeDumpVectorOneAtATime_v<V> && ContiguousStorage<Cont> && detail::isStridedChronoField<V, Fs...>())
+                {
+                    // std::chrono member variable: gather the tick counts and encode them
+                    const auto field = detail::fieldAddress(*std::cbegin(data_), fields_...);
+                    detail::gatherEncodeTicks<std::remove_cvref_t<decltype(*field)>, last<0, Fs...>>(reinterpret_cast<const std::byte*>(field), sizeof(V), data_.size(), storage);
+                }
+                else if constexpr (!typeDumpVectorOneAtATime_v<V>)
                 {
                     for (auto&& item : data_)
                         (*storage++) = nested_field::getWrapper(item, fields_...);
@@ -404,9 +968,281 @@ namespace mxTypes {
         }
         else // NB: if constexpr (typeToMxClass_v<U> == mxSTRUCT_CLASS)
         {
-            static_assert(always_false_t<Cont>, "Shouldn't happen, check you didn't override typeToMxClass for this type");   // or is this a TODO implement? Analyze situation when i encounter it
+            static_assert(always_false_t<Cont>, "To export a field of struct type, register a fieldSchema for it (or use FieldsToMatlab() with Nested())");
+        }
+
+        return temp;
+    }
+
+    template <typename Cont, typename... Cols>
+    requires Container<Cont>
+    mxArray* FieldsToMatlab(const Cont& data_, bool rowVector_, Cols... columns_)
+    {
+        using V = typename Cont::value_type;
+        return detail::structOfArraysToMatlab<V>(data_.size(), rowVector_, [&](auto&& f_)
+        {
+            for (auto&& item : data_)
+                f_(item);
+        }, std::tuple<>{}, std::tuple{ columns_... });
+    }
+
+    template <typename Seg, size_t NSeg, typename... Cols>
+    mxArray* ColumnsToMatlab(const std::array<Seg, NSeg>& segments_, bool rowVector_, Cols... columns_)
+    {
+        using V = std::decay_t<decltype(*std::begin(segments_[0]))>;
+        size_t nElem = 0;
+        for (auto&& seg : segments_)
+            nElem += std::size(seg);
+        return detail::structOfArraysToMatlab<V>(nElem, rowVector_, [&](auto&& f_)
+        {
+            for (auto&& seg : segments_)
+                for (auto&& item : seg)
+                    f_(item);
+        }, std::tuple<>{}, std::tuple{ columns_... });
+    }
+
+    //// selections
+    namespace detail
+    {
+        template <typename Cont, typename Sel>
+        void checkSelection(const Cont& data_, const Sel& selection_, const char* funcID_)
+        {
+            auto fail = [&](const std::string& msg_) { throw "SWAG::" + std::string(funcID_) + ": " + msg_; };
+            if constexpr (std::is_same_v<Sel, IndexRange>)
+            {
+                if (selection_.first > selection_.last || selection_.last > data_.size())
+                    fail("Index range [" + std::to_string(selection_.first) + ", " + std::to_string(selection_.last) + ") out of bounds for a container with " + std::to_string(data_.size()) + " elements.");
+            }
+            else if constexpr (std::is_same_v<Sel, SortedIndices>)
+            {
+                if (!std::is_sorted(selection_.indices.begin(), selection_.indices.end()))
+                    fail("Indices must be sorted in ascending order.");
+                if (!selection_.indices.empty() && selection_.indices.back() >= data_.size())
+                    fail("Index " + std::to_string(selection_.indices.back()) + " out of bounds for a container with " + std::to_string(data_.size()) + " elements.");
+            }
+        }
+
+        // number of selected elements, for a predicate this is the counting pass
+        template <typename Cont, typename Sel>
+        size_t selectionSize(const Cont& data_, const Sel& selection_)
+        {
+            if constexpr (std::is_same_v<Sel, IndexRange>)
+                return selection_.last - selection_.first;
+            else if constexpr (std::is_same_v<Sel, SortedIndices>)
+                return selection_.indices.size();
+            else
+            {
+                size_t n = 0;
+                for (auto&& item : data_)
+                    n += static_cast<bool>(std::invoke(selection_.pred, item));
+                return n;
+            }
+        }
+
+        // invoke f_ for each selected element, in order. Single forward pass over the container
+        template <typename Cont, typename Sel, typename F>
+        void forEachSelected(const Cont& data_, const Sel& selection_, F&& f_)
+        {
+            if constexpr (std::is_same_v<Sel, IndexRange>)
+            {
+                auto it = std::next(std::cbegin(data_), selection_.first);
+                for (size_t i = selection_.first; i < selection_.last; ++i, ++it)
+                    f_(*it);
+            }
+            else if constexpr (std::is_same_v<Sel, SortedIndices>)
+            {
+                auto   it  = std::cbegin(data_);
+                size_t pos = 0;
+                for (auto idx : selection_.indices)
+                {
+                    std::advance(it, idx - pos);
+                    pos = idx;
+                    f_(*it);
+                }
+            }
+            else
+            {
+                for (auto&& item : data_)
+                    if (std::invoke(selection_.pred, item))
+                        f_(item);
+            }
+        }
+    }
+
+    template <typename Cont, Selection Sel, typename... Extras>
+    requires Container<Cont>
+    mxArray* ToMatlab(const Cont& data_, const Sel& selection_, Extras&&... extras_)
+    {
+        detail::checkSelection(data_, selection_, "ToMatlab");
+        mxArray* temp = nullptr;
+        using V = typename Cont::value_type;
+        auto   nElem  = static_cast<mwSize>(detail::selectionSize(data_, selection_));
+        auto   rCount = nElem;
+        mwSize cCount = 1;
+        if (MEX_TYPE_UTILS_OUTPUT_ROWVECTORS)
+            std::swap(rCount, cCount);
+
+        if constexpr (Chrono<V>)
+        {
+            // std::chrono values: output their encoding, Ticks by default
+            static_assert(sizeof...(Extras) < 2 && (ChronoEncoding<std::decay_t<Extras>> && ...), "std::chrono values take at most one extra argument to ToMatlab(), their encoding.");
+            using E   = std::tuple_element_t<0, std::tuple<std::decay_t<Extras>..., Ticks>>;
+            using Out = decltype(E{}(std::declval<V>()));
+            auto storage = static_cast<Out*>(mxGetData(temp = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<Out>, mxREAL)));
+
+            if constexpr (std::is_same_v<Sel, IndexRange> && ContiguousStorage<Cont> && detail::chronoIsRep<V>)
+            {
+                // memcpy, or vectorised scaling, of the tick counts
+                if (nElem)
+                    detail::encodeTicks<V, E>(reinterpret_cast<const typename detail::chronoTraits<V>::rep*>(&*std::next(std::cbegin(data_), selection_.first)), nElem, storage);
+            }
+            else
+                detail::forEachSelected(data_, selection_, [&](const V& item_) { (*storage++) = E{}(item_); });
+        }
+        else if constexpr (typeNeedsMxCellStorage_v<V>)
+        {
+            // output cell array
+            temp = mxCreateCellMatrix(rCount, cCount);
+            mwIndex i = 0;
+            detail::forEachSelected(data_, selection_, [&](const V& item_)
+            {
+                mxSetCell(temp, i++, ToMatlab(item_, std::forward<Extras>(extras_)...));
+            });
+        }
+        else if constexpr (typeToMxClass_v<V> != mxSTRUCT_CLASS)
+        {
+            // output array
+            static_assert(sizeof...(Extras) < 2, "Only 0 (normal case) or 1 (type tag dispatch) extra arguments to ToMatlab() are supported for this branch.");
+            using outputType = std::tuple_element_t<0, std::tuple<std::decay_t<Extras>..., V>>;
+            auto storage = static_cast<outputType*>(mxGetData(temp = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<outputType>, mxREAL)));
+
+            if constexpr (std::is_same_v<Sel, IndexRange> && ContiguousStorage<Cont> && std::is_same_v<outputType, V>)
+            {
+                if (nElem)
+                    memcpy(storage, &*std::next(std::cbegin(data_), selection_.first), nElem * sizeof(V));
+            }
+            else
+                detail::forEachSelected(data_, selection_, [&](const V& item_) { (*storage++) = static_cast<outputType>(item_); });
+        }
+        else // NB: if constexpr (typeToMxClass_v<V> == mxSTRUCT_CLASS)
+        {
+            // output array of structs
+            if (!nElem)
+                if constexpr (std::is_default_constructible_v<V>)   // try hard to produce struct with empty fields
+                    temp = ToMatlab(V{}, 0, rCount, cCount, temp, std::forward<Extras>(extras_)...);
+                else    // fall back to just empty
+                    temp = mxCreateDoubleMatrix(rCount, cCount, mxREAL);
+            else
+            {
+                mwIndex i = 0;
+                detail::forEachSelected(data_, selection_, [&](const V& item_)
+                {
+                    temp = ToMatlab(item_, i++, rCount, cCount, temp, std::forward<Extras>(extras_)...);
+                });
+            }
+        }
+        return temp;
+    }
+
+    template <typename Cont, Selection Sel, typename... Fs>
+    requires Container<Cont>
+    mxArray* FieldToMatlab(const Cont& data_, const Sel& selection_, const bool rowVector_, Fs... fields_)
+    {
+        detail::checkSelection(data_, selection_, "FieldToMatlab");
+        mxArray* temp;
+        using V = typename Cont::value_type;
+        using U = decltype(nested_field::getWrapper(std::declval<V>(), fields_...));
+        const size_t nElem = detail::selectionSize(data_, selection_);
+        auto   rCount = static_cast<mwSize>(nElem);
+        mwSize cCount = 1;
+        if (rowVector_)
+            std::swap(rCount, cCount);
+
+        if constexpr (HasFieldSchema<std::decay_t<U>> && (std::is_member_object_pointer_v<Fs> && ...))
+        {
+            // field is a struct with a registered schema: output nested struct of arrays
+            temp = detail::structOfArraysToMatlab<V>(nElem, rowVector_, [&](auto&& f_)
+            {
+                detail::forEachSelected(data_, selection_, f_);
+            }, std::make_tuple(fields_...), fieldSchema<std::decay_t<U>>::value);
+        }
+        else if constexpr (Chrono<std::decay_t<U>>)
+            // std::chrono field without encoding: default encoding
+            temp = FieldToMatlab(data_, selection_, rowVector_, fields_..., Ticks{});
+        else if constexpr (typeNeedsMxCellStorage_v<U>)
+        {
+            // output cell array
+            temp = mxCreateCellMatrix(rCount, cCount);
+            mwIndex i = 0;
+            detail::forEachSelected(data_, selection_, [&](const V& item_)
+            {
+                mxSetCell(temp, i++, ToMatlab(nested_field::getWrapper(item_, fields_...)));
+            });
+        }
+        else if constexpr (typeToMxClass_v<U> != mxSTRUCT_CLASS)
+        {
+            // output array
+            auto storage = static_cast<U*>(mxGetData(temp = mxCreateUninitNumericMatrix(rCount, cCount, typeToMxClass_v<U>, mxREAL)));
+
+            if constexpr (std::is_same_v<Sel, IndexRange> && ContiguousStorage<Cont> && detail::isStridedField<V, Fs...>())
+            {
+                // contiguous range of a plain member variable: gather straight from the objects' storage
+                if (nElem)
+                {
+                    const auto field = detail::fieldAddress(*std::next(std::cbegin(data_), selection_.first), fields_...);
+                    using In = std::remove_cvref_t<decltype(*field)>;
+                    strided_gather::gather<In>(reinterpret_cast<const std::byte*>(field), sizeof(V), nElem, storage);
+                }
+            }
+            else if constexpr (std::is_same_v<Sel, IndexRange> && ContiguousStorage<Cont> && detail::isStridedChronoField<V, Fs...>())
+            {
+                // contiguous range of a std::chrono member variable: gather the tick counts and encode them
+                if (nElem)
+                {
+                    const auto field = detail::fieldAddress(*std::next(std::cbegin(data_), selection_.first), fields_...);
+                    detail::gatherEncodeTicks<std::remove_cvref_t<decltype(*field)>, last<0, Fs...>>(reinterpret_cast<const std::byte*>(field), sizeof(V), nElem, storage);
+                }
+            }
+            else
+                detail::forEachSelected(data_, selection_, [&](const V& item_) { (*storage++) = nested_field::getWrapper(item_, fields_...); });
+        }
+        else // NB: if constexpr (typeToMxClass_v<U> == mxSTRUCT_CLASS)
+        {
+            static_assert(always_false_t<Cont>, "To export a field of struct type, register a fieldSchema for it (or use FieldsToMatlab() with Nested())");
         }
 
         return temp;
     }
-}
\ No newline at end of file
+
+    template <typename Cont, Selection Sel, typename... Cols>
+    requires Container<Cont>
+    mxArray* FieldsToMatlab(const Cont& data_, const Sel& selection_, bool rowVector_, Cols... columns_)
+    {
+        detail::checkSelection(data_, selection_, "FieldsToMatlab");
+        using V = typename Cont::value_type;
+        return detail::structOfArraysToMatlab<V>(detail::selectionSize(data_, selection_), rowVector_, [&](auto&& f_)
+        {
+            detail::forEachSelected(data_, selection_, f_);
+        }, std::tuple<>{}, std::tuple{ columns_... });
+    }
+
+    template <typename Cont, typename T, typename... Fs>
+    requires Container<Cont>
+    IndexRange TimeWindow(const Cont& data_, T from_, T to_, Fs... fields_)
+    {
+        auto before = [&](const T& bound_)
+        {
+            return [&, bound_](const typename Cont::value_type& item_)
+            {
+                if constexpr (sizeof...(Fs) == 0)
+                    return item_ < bound_;
+                else
+                    return nested_field::getWrapper(item_, fields_...) < bound_;
+            };
+        };
+        const auto b = std::partition_point(std::cbegin(data_), std::cend(data_), before(from_));
+        const auto e = std::partition_point(b, std::cend(data_), before(to_));
+        const auto first = static_cast<size_t>(std::distance(std::cbegin(data_), b));
+        return { first, first + static_cast<size_t>(std::distance(b, e)) };
+    }
+}
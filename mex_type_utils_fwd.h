@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <array>
+#include <span>
 
 #include <variant>
 #include <optional>
@@ -9,14 +11,19 @@
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
+#include <bitset>
 
 #include <utility>
 #include <tuple>
+#include <chrono>
+#include <ratio>
 
 
 #include "include_matlab.h"
 #include "is_container_trait.h"
 #include "is_specialization_trait.h"
+#include "mex_enum_names.h"
 
 // specify whether vectors and other containers are converted to Matlab row, or column vectors.
 // by default column vectors are used
@@ -43,11 +50,226 @@ namespace mxTypes {
     inline constexpr bool typeDumpVectorOneAtATime_v = typeDumpVectorOneAtATime<T>::value;
 
     template <mxClassID T>
-    constexpr mxClassID MxClassToType();
+    struct mxClassToType;
+    template <mxClassID T>
+    using mxClassToType_t = typename mxClassToType<T>::type;
 
     template <mxClassID T>
     constexpr const char* mxClassToString();
 
+    // container of (non-string) containers of arithmetic type, e.g. std::vector<std::vector<double>>.
+    // Besides as a cell array, these can be exported using a ragged encoding (see Ragged tag below)
+    template <typename Cont>
+    concept RaggedContainer =
+        Container<Cont> &&
+        Container<typename Cont::value_type> &&
+        !std::is_same_v<typename Cont::value_type, std::string> &&
+        std::is_arithmetic_v<typename Cont::value_type::value_type>;
+
+    // std::vector<bool> (whose reference type is a proxy, so it is not a Container) and std::bitset:
+    // converted to and from logical arrays
+    template <typename T>
+    struct is_bitset : std::false_type {};
+    template <size_t N>
+    struct is_bitset<std::bitset<N>> : std::true_type {};
+    template <typename T>
+    concept BitContainer = std::is_same_v<T, std::vector<bool>> || is_bitset<T>::value;
+
+    // std::array of arithmetic type, e.g. a point. A container of these (a RaggedContainer with inner containers of
+    // fixed size) is read from a matrix with as many columns as the std::array has elements
+    template <typename T>
+    struct is_std_array : std::false_type {};
+    template <typename T, size_t N>
+    struct is_std_array<std::array<T, N>> : std::true_type {};
+    template <typename T>
+    concept FixedRow = is_std_array<T>::value && std::is_arithmetic_v<typename T::value_type>;
+
+    //// tags selecting an alternative output encoding, passed as extra argument to ToMatlab
+    // ragged encoding of a container of containers: instead of a cell array with one array per inner
+    // container, output a struct with two fields:
+    // data   : elements of all inner containers concatenated
+    // offsets: uint64 array with, for each inner container, the 0-based index of its first element in
+    //          data, followed by an extra element containing numel(data). So inner container i (1-based)
+    //          is data(offsets(i)+1:offsets(i+1)) in MATLAB
+    // if denseIfRectangular is set and all inner containers have the same, non-zero, size, an nOuter x nInner
+    // matrix (one row per inner container) is output instead
+    struct Ragged
+    {
+        bool denseIfRectangular = false;
+    };
+    // container of registered enums (see enumNames in mex_enum_names.h), which by default are output as a
+    // cellstring, output as a struct with two fields:
+    // codes: array of 1-based indices into names (smallest unsigned integer class that fits). 0 for values
+    //        that are not registered
+    // names: cellstring with all registered names
+    struct EnumCodes {};
+    // container of registered enums, output as a struct with two fields (cf. [categories,~,index] = unique(...)):
+    // categories: cellstring with the names of the values occurring in the container, in registration order
+    // index     : array of 1-based indices into categories (smallest unsigned integer class that fits). 0 for
+    //             values that are not registered
+    struct EnumCategorical {};
+    // container of std::optional of an arithmetic type, or of std::variant of arithmetic types, which by
+    // default are output as a cell array with an array per element (empty for nullopt), output as:
+    // - std::optional<floating point type>: array of that type, NaN for missing values
+    // - std::optional<integer or bool>: struct with two fields:
+    //   values: array of that type, 0 for missing values
+    //   valid : logical array, false for missing values
+    // - std::variant<arithmetic types...>: array of their common type (std::common_type_t)
+    // FromMatlab accepts these encodings for the same container types. NB: so a NaN value in a container
+    // of std::optional<floating point type> comes back as nullopt, and a variant value comes back as the
+    // first alternative that represents it exactly
+    struct Dense {};
+    template <typename T>
+    concept DenseOptional = is_specialization_v<T, std::optional> && std::is_arithmetic_v<typename T::value_type>;
+    template <typename T>
+    struct isArithmeticVariant : std::false_type {};
+    template <typename... Ts>
+    struct isArithmeticVariant<std::variant<Ts...>> : std::bool_constant<(std::is_arithmetic_v<Ts> && ...)> {};
+    template <typename T>
+    concept DenseVariant = isArithmeticVariant<T>::value;
+    template <typename T>
+    concept DenseElement = DenseOptional<T> || DenseVariant<T>;
+    // storage type of the dense encoding of a container of T
+    template <DenseElement T>
+    struct denseStorage;
+    template <typename T>
+    struct denseStorage<std::optional<T>> { using type = T; };
+    template <typename... Ts>
+    struct denseStorage<std::variant<Ts...>> { using type = std::common_type_t<Ts...>; };
+    template <DenseElement T>
+    using denseStorage_t = typename denseStorage<T>::type;
+
+    //// std::chrono::duration and std::chrono::time_point values are exported as numbers, in one of the
+    //// encodings below. The encoding is passed as extra argument to ToMatlab and FromMatlab, or as the last
+    //// element of a field specification (e.g. FieldToMatlab(data, false, &Rec::time, Seconds{})). Default is Ticks
+    template <typename T>
+    concept Chrono = is_specialization_v<T, std::chrono::duration> || is_specialization_v<T, std::chrono::time_point>;
+    namespace detail
+    {
+        template <typename T>
+        struct chronoTraits;
+        template <typename Rep, typename Period>
+        struct chronoTraits<std::chrono::duration<Rep, Period>>
+        {
+            using T   = std::chrono::duration<Rep, Period>;
+            using rep = Rep;
+            static constexpr Rep count(T v_) { return v_.count(); }
+            static constexpr T fromCount(Rep c_) { return T(c_); }
+        };
+        template <typename Clock, typename Duration>
+        struct chronoTraits<std::chrono::time_point<Clock, Duration>>
+        {
+            using T   = std::chrono::time_point<Clock, Duration>;
+            using rep = typename Duration::rep;
+            static constexpr rep count(T v_) { return v_.time_since_epoch().count(); }
+            static constexpr T fromCount(rep c_) { return T(Duration(c_)); }
+        };
+        // whether the tick counts of a contiguous array of T can be accessed as an array of its representation type
+        template <typename T>
+        inline constexpr bool chronoIsRep = std::is_standard_layout_v<T> && sizeof(T) == sizeof(typename chronoTraits<T>::rep);
+        template <typename T>
+        inline constexpr bool isSysTime = false;
+        template <typename Duration>
+        inline constexpr bool isSysTime<std::chrono::time_point<std::chrono::system_clock, Duration>> = true;
+
+        // encodings other than Ticks are linear in the tick count: count * unit + offset, with unit a std::ratio
+        template <typename E>
+        struct linearChronoEncoding
+        {
+            template <Chrono T>
+            static constexpr double scale()
+            {
+                using U = typename E::template unit<T>;
+                return static_cast<double>(U::num) / static_cast<double>(U::den);
+            }
+            template <Chrono T>
+            static constexpr double invScale()
+            {
+                using U = typename E::template unit<T>;
+                return static_cast<double>(U::den) / static_cast<double>(U::num);
+            }
+            template <Chrono T>
+            double operator()(T v_) const
+            {
+                return static_cast<double>(chronoTraits<T>::count(v_)) * scale<T>() + E::template offset<T>();
+            }
+        };
+    }
+    // count of ticks, as the representation type of the duration (int64 for the standard durations). For time
+    // points, since the clock's epoch
+    struct Ticks
+    {
+        template <Chrono T>
+        constexpr auto operator()(T v_) const { return detail::chronoTraits<T>::count(v_); }
+    };
+    // double seconds. For time points, since the clock's epoch
+    struct Seconds : detail::linearChronoEncoding<Seconds>
+    {
+        template <Chrono T>
+        using unit = typename T::period;
+        template <Chrono T>
+        static constexpr double offset() { return 0.; }
+    };
+    // time points of std::chrono::system_clock: double seconds since 1970-01-01 00:00:00 UTC (cf.
+    // datetime(t, 'ConvertFrom', 'posixtime'))
+    struct PosixTime : detail::linearChronoEncoding<PosixTime>
+    {
+        template <Chrono T>
+        using unit = typename T::period;
+        template <Chrono T>
+        static constexpr double offset()
+        {
+            static_assert(detail::isSysTime<T>, "PosixTime only applies to time points of std::chrono::system_clock");
+            return 0.;
+        }
+    };
+    // time points of std::chrono::system_clock: double days since 0000-01-00 (MATLAB datenum, cf.
+    // datetime(t, 'ConvertFrom', 'datenum'))
+    struct Datenum : detail::linearChronoEncoding<Datenum>
+    {
+        template <Chrono T>
+        using unit = std::ratio_divide<typename T::period, std::ratio<86400>>;
+        template <Chrono T>
+        static constexpr double offset()
+        {
+            static_assert(detail::isSysTime<T>, "Datenum only applies to time points of std::chrono::system_clock");
+            return 719529.;     // datenum(1970, 1, 1)
+        }
+    };
+    template <typename T>
+    concept ChronoEncoding = std::is_same_v<T, Ticks> || std::is_same_v<T, Seconds> || std::is_same_v<T, PosixTime> || std::is_same_v<T, Datenum>;
+
+    //// selections of the elements of a container, for exporting part of a container without first copying
+    //// the selected elements, passed after the container to ToMatlab, FieldToMatlab and FieldsToMatlab
+    // elements [first, last)
+    struct IndexRange
+    {
+        size_t first;
+        size_t last;
+    };
+    // elements at the given (0-based, ascending) indices
+    struct SortedIndices
+    {
+        std::span<const size_t> indices;
+    };
+    // elements for which pred returns true. Outputs are sized by a counting pass over the container,
+    // then filled in a second pass, so pred is invoked twice per element
+    template <typename Pred>
+    struct Where
+    {
+        Pred pred;
+    };
+    template <typename T>
+    concept Selection = std::is_same_v<T, IndexRange> || std::is_same_v<T, SortedIndices> || is_specialization_v<T, Where>;
+
+    // runtime dispatch on the class of a numeric array: invokes f_ with a typed, zero-copy view of the
+    // array's data (std::span<const T>) and its dimensions (std::span<const mwSize>), with T the C++
+    // type corresponding to the array's class. f_ should thus be a generic callable, e.g.
+    // [](auto data_, auto dims_) {...}, which will be instantiated for each numeric class and must
+    // return the same type for each. Complex, sparse and non-numeric input throws
+    template <typename F>
+    decltype(auto) VisitNumeric(const mxArray* inp_, F&& f_);
+
     //// converters of generic data types to MATLAB variables
     //// to simple variables
     inline mxArray* ToMatlab(std::string str_);
@@ -57,12 +279,17 @@ namespace mxTypes {
     mxArray* ToMatlab(T val_);
 
     template<class Cont, typename... Extras>
-    requires Container<Cont>
+    requires Container<Cont> && (!Selection<std::decay_t<std::tuple_element_t<0, std::tuple<Extras..., void>>>>)
     mxArray* ToMatlab(Cont data_, Extras&& ...extras_);
     inline mxArray* ToMatlab(std::monostate);
     template <class... Types>  mxArray* ToMatlab(std::variant<Types...> val_);
     template <class T>         mxArray* ToMatlab(std::optional<T> val_);
     template <class T>         mxArray* ToMatlab(std::shared_ptr<T> val_);
+    // bit containers -> logical array
+    inline mxArray* ToMatlab(const std::vector<bool>& data_);
+    template <size_t N>        mxArray* ToMatlab(const std::bitset<N>& data_);
+    // registered enums -> string, empty for unregistered values
+    template <RegisteredEnum E> mxArray* ToMatlab(E val_);
 
     // associative containers
     // associative key-value container with unique string keys -> matlab struct
@@ -102,9 +329,34 @@ namespace mxTypes {
             is_specialization_v<typename Cont::value_type, std::tuple>)
     mxArray* ToMatlab(Cont data_);
 
+    // container of containers, ragged encoding
+    template<class Cont>
+    requires RaggedContainer<Cont>
+    mxArray* ToMatlab(const Cont& data_, Ragged opts_);
+
+    // containers of registered enums, codes or categorical encoding
+    template<class Cont>
+    requires Container<Cont> && RegisteredEnum<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, EnumCodes);
+    template<class Cont>
+    requires Container<Cont> && RegisteredEnum<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, EnumCategorical);
+
+    // containers of optional or variant arithmetic values, dense encoding
+    template<class Cont>
+    requires Container<Cont> && DenseElement<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, Dense);
+
+    // std::chrono durations and time points, and containers of them
+    template <Chrono T, ChronoEncoding E = Ticks>
+    mxArray* ToMatlab(T val_, E encoding_ = {});
+    template <class Cont, ChronoEncoding E = Ticks>
+    requires Container<Cont> && Chrono<typename Cont::value_type>
+    mxArray* ToMatlab(const Cont& data_, E encoding_ = {});
+
     // generic ToMatlab that converts provided data through type tag dispatch
     template <class T, class U>
-    requires (!Container<T>)
+    requires (!Container<T>) && requires (T v_) { static_cast<U>(v_); }
     mxArray* ToMatlab(T val_, U);
 
     //// struct of arrays
@@ -113,4 +365,83 @@ namespace mxTypes {
     template<typename Cont, typename... Fs>
     requires Container<Cont>
     mxArray* FieldToMatlab(const Cont& data_, bool rowVector_, Fs... fields_);
+
+    // a named column, consisting of field specifications as accepted by FieldToMatlab
+    template <typename... Fs>
+    struct NamedColumn
+    {
+        const char*         name;
+        std::tuple<Fs...>   fields;
+    };
+    template <typename... Fs>
+    constexpr NamedColumn<Fs...> Column(const char* name_, Fs... fields_)
+    {
+        return { name_, std::make_tuple(fields_...) };
+    }
+    // a named nested struct: members are reached through the pointers to member variables in path, and
+    // exported as a struct with a field per child (Column() or Nested(), relative to the object reached
+    // through path). Create with Nested(name, memberPtrs..., children...), e.g.
+    // Nested("left", &Sample::left, Column("pupil", &Eye::pupil, &Pupil::diameter), Nested("gaze", &Eye::gazePoint, Column("x", &Point::x)))
+    template <typename Path, typename Children>
+    struct NestedColumn
+    {
+        const char* name;
+        Path        path;
+        Children    children;
+    };
+    template <typename... Args>
+    constexpr auto Nested(const char* name_, Args... args_)
+    {
+        // leading pointers to member variables are the path, the rest are children
+        constexpr std::array<bool, sizeof...(Args) + 1> isMember = { std::is_member_object_pointer_v<Args>..., false };
+        constexpr size_t nPath = [&] { size_t i = 0; while (isMember[i]) i++; return i; }();
+        auto all = std::make_tuple(args_...);
+        return [&]<size_t... Ps, size_t... Cs>(std::index_sequence<Ps...>, std::index_sequence<Cs...>)
+        {
+            return NestedColumn<std::tuple<std::tuple_element_t<Ps, std::tuple<Args...>>...>, std::tuple<std::tuple_element_t<nPath + Cs, std::tuple<Args...>>...>>
+            { name_, { std::get<Ps>(all)... }, { std::get<nPath + Cs>(all)... } };
+        }(std::make_index_sequence<nPath>{}, std::make_index_sequence<sizeof...(Args) - nPath>{});
+    }
+
+    // register a schema for a struct type, used to export fields of that type as a nested struct of
+    // arrays (instead of a cell array with a value per element) by FieldToMatlab, ColumnsToMatlab and
+    // FieldsToMatlab. Specialize with a tuple of Column()s and Nested()s, relative to the struct:
+    // namespace mxTypes {
+    //     template <>
+    //     struct fieldSchema<Point>
+    //     {
+    //         static constexpr auto value = std::make_tuple(Column("x", &Point::x), Column("y", &Point::y));
+    //     };
+    // }
+    template <typename T>
+    struct fieldSchema;
+    template <typename T>
+    concept HasFieldSchema = requires { fieldSchema<T>::value; };
+
+    // struct with a field per provided Column() or Nested(), each containing an array with the
+    // selected field of all objects in the container. Done in a single pass over the container
+    template <typename Cont, typename... Cols>
+    requires Container<Cont>
+    mxArray* FieldsToMatlab(const Cont& data_, bool rowVector_, Cols... columns_);
+    // same, but over the concatenation of all objects in all segments (ranges of objects, e.g. std::span),
+    // in order
+    template <typename Seg, size_t NSeg, typename... Cols>
+    mxArray* ColumnsToMatlab(const std::array<Seg, NSeg>& segments_, bool rowVector_, Cols... columns_);
+
+    // same as ToMatlab(), FieldToMatlab() and FieldsToMatlab(), but for the selected elements only
+    template <typename Cont, Selection Sel, typename... Extras>
+    requires Container<Cont>
+    mxArray* ToMatlab(const Cont& data_, const Sel& selection_, Extras&&... extras_);
+    template <typename Cont, Selection Sel, typename... Fs>
+    requires Container<Cont>
+    mxArray* FieldToMatlab(const Cont& data_, const Sel& selection_, bool rowVector_, Fs... fields_);
+    template <typename Cont, Selection Sel, typename... Cols>
+    requires Container<Cont>
+    mxArray* FieldsToMatlab(const Cont& data_, const Sel& selection_, bool rowVector_, Cols... columns_);
+    // range of the elements of a container sorted by the field selected by fields_ (e.g., a timestamp, field
+    // specifications as for FieldToMatlab, none for a container of values) whose value lies in [from_, to_).
+    // Found by binary search, e.g.: FieldToMatlab(samples, TimeWindow(samples, t0, t1, &Sample::ts), false, &Sample::x)
+    template <typename Cont, typename T, typename... Fs>
+    requires Container<Cont>
+    IndexRange TimeWindow(const Cont& data_, T from_, T to_, Fs... fields_);
 }
\ No newline at end of file
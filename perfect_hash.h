@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// compile-time construction of a minimal-collision (perfect) hash table for a fixed set of string keys.
+// Uses hash and displace: keys are first distributed over N buckets, then for each bucket (largest
+// first) a seed is searched for that places all its keys in free slots of the table. Lookup thus
+// costs two hashes of the queried string and one string comparison, regardless of the number of keys.
+// Construction fails to compile if keys are not unique.
+namespace perfect_hash
+{
+    // FNV-1a, mixed with a seed
+    constexpr uint32_t hash(std::string_view str_, uint32_t seed_)
+    {
+        uint32_t h = 2166136261u ^ (seed_ * 0x9E3779B9u);
+        for (const char c : str_)
+        {
+            h ^= static_cast<uint8_t>(c);
+            h *= 16777619u;
+        }
+        // final avalanche, so the masked low bits depend on all input bytes
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        return h;
+    }
+
+    template <std::size_t N>
+    struct table
+    {
+        static constexpr std::size_t nBucket = N ? N : 1;
+        static constexpr std::size_t nSlot   = std::bit_ceil(2 * nBucket);
+        static constexpr std::size_t npos    = N;
+
+        std::array<std::string_view, N> keys{};
+        std::array<uint32_t, nBucket>   seeds{};
+        std::array<std::size_t, nSlot>  slots{};    // index into keys, npos if empty
+
+        // returns index of key_ in the keys the table was constructed from, or npos if not found
+        constexpr std::size_t find(std::string_view key_) const
+        {
+            if constexpr (N == 0)
+                return npos;
+            else
+            {
+                const auto seed = seeds[hash(key_, 0) % nBucket];
+                const auto idx  = slots[hash(key_, seed) & (nSlot - 1)];
+                return idx != npos && keys[idx] == key_ ? idx : npos;
+            }
+        }
+    };
+
+    template <std::size_t N>
+    constexpr table<N> make_table(const std::array<std::string_view, N>& keys_)
+    {
+        using T = table<N>;
+        T out;
+        out.keys = keys_;
+        out.slots.fill(T::npos);
+
+        for (std::size_t i = 0; i < N; i++)
+            for (std::size_t j = i + 1; j < N; j++)
+                if (keys_[i] == keys_[j])
+                    throw "perfect_hash::make_table: keys must be unique";
+
+        // distribute keys over buckets
+        std::array<std::size_t, T::nBucket> bucketOf{}, bucketSize{};
+        for (std::size_t i = 0; i < N; i++)
+            bucketSize[bucketOf[i] = hash(keys_[i], 0) % T::nBucket]++;
+
+        // process buckets from large to small, find seed that places all keys in the bucket in free slots
+        std::array<bool, T::nBucket> done{};
+        for (std::size_t b = 0; b < T::nBucket; b++)
+        {
+            std::size_t bucket = 0, largest = 0;
+            for (std::size_t c = 0; c < T::nBucket; c++)
+                if (!done[c] && bucketSize[c] >= largest)
+                {
+                    bucket  = c;
+                    largest = bucketSize[c];
+                }
+            done[bucket] = true;
+            if (!largest)
+                continue;
+
+            for (uint32_t seed = 1; ; seed++)
+            {
+                std::array<std::size_t, N> placed{};
+                std::size_t nPlaced = 0;
+                bool ok = true;
+                for (std::size_t i = 0; i < N && ok; i++)
+                {
+                    if (bucketOf[i] != bucket)
+                        continue;
+                    const auto slot = hash(keys_[i], seed) & (T::nSlot - 1);
+                    ok = out.slots[slot] == T::npos;
+                    for (std::size_t p = 0; p < nPlaced && ok; p++)
+                        ok = placed[p] != slot;
+                    placed[nPlaced++] = slot;
+                }
+                if (!ok)
+                    continue;
+
+                out.seeds[bucket] = seed;
+                for (std::size_t i = 0, p = 0; i < N; i++)
+                    if (bucketOf[i] == bucket)
+                        out.slots[placed[p++]] = i;
+                break;
+            }
+        }
+        return out;
+    }
+}
\ No newline at end of file
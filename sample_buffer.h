@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+// multi-producer single-consumer buffer of records, for handing samples from (SDK) callback threads to
+// the mex thread. Pushing is lock-free: a producer claims a slot by advancing a shared position, writes
+// the record into it and then publishes it through the slot's sequence number. Storage consists of
+// fixed-size chunks that are allocated when first needed and kept for reuse, so records are never moved
+// and a push never reallocates (call reserve() beforehand to also avoid the one-off chunk allocations on
+// the producer threads). The buffer holds at most capacity() records, pushes fail when it is full.
+//
+// producers (any thread):
+// buffer.push(sample);
+// consumer (a single thread at a time):
+// const size_t n = buffer.available();
+// buffer.forEachSegment(n, [](std::span<const Sample> seg_) { ... });   // records in push order
+// buffer.consume(n);
+// Records pushed concurrently by different threads are ordered by when they claimed their slot.
+namespace sample_buffer
+{
+    template <typename T, size_t ChunkSize = 4096>
+    class Buffer
+    {
+        static_assert(std::has_single_bit(ChunkSize), "ChunkSize must be a power of two");
+        static_assert(std::is_default_constructible_v<T> && std::is_copy_assignable_v<T>, "records must be default constructible and copy assignable");
+    public:
+        // maxCapacity_ is rounded up to a power-of-two number of chunks
+        explicit Buffer(size_t maxCapacity_ = size_t{ 1 } << 20) :
+            _nChunk(std::bit_ceil(std::max<size_t>((maxCapacity_ + ChunkSize - 1) / ChunkSize, 1))),
+            _mask(_nChunk * ChunkSize - 1),
+            _chunks(std::make_unique<std::atomic<Chunk*>[]>(_nChunk))
+        {}
+        ~Buffer()
+        {
+            for (size_t c = 0; c < _nChunk; c++)
+                delete _chunks[c].load(std::memory_order_relaxed);
+        }
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        size_t capacity() const { return static_cast<size_t>(_mask + 1); }
+        // allocate storage for (at least) nRecords_ records up front
+        void reserve(size_t nRecords_)
+        {
+            const size_t n = std::min((nRecords_ + ChunkSize - 1) / ChunkSize, _nChunk);
+            for (size_t c = 0; c < n; c++)
+                getChunk(c);
+        }
+        // number of pushes that failed because the buffer was full
+        uint64_t nDropped() const { return _nDropped.load(std::memory_order_relaxed); }
+
+        //// producer side, any thread
+        // returns false (and drops the record) if the buffer is full
+        bool push(const T& record_)
+        {
+            return pushImpl([&](T& slot_) { slot_ = record_; });
+        }
+        bool push(T&& record_)
+        {
+            return pushImpl([&](T& slot_) { slot_ = std::move(record_); });
+        }
+
+        //// consumer side
+        // number of (at most maxRecords_) records that are ready for reading, in order
+        size_t available(size_t maxRecords_ = static_cast<size_t>(-1)) const
+        {
+            const size_t max = std::min(maxRecords_, capacity());
+            size_t n = 0;
+            for (; n < max; n++)
+            {
+                const uint64_t pos   = _dequeue + n;
+                const Chunk*   chunk = _chunks[(pos & _mask) / ChunkSize].load(std::memory_order_acquire);
+                if (!chunk || chunk->seqs[pos & (ChunkSize - 1)].load(std::memory_order_acquire) != pos + 1)
+                    break;
+            }
+            return n;
+        }
+        // invoke f_ with the first nRecords_ (at most available()) records, as contiguous segments
+        // (std::span<const T>), in order. The records remain valid until consume() is called
+        template <typename F>
+        void forEachSegment(size_t nRecords_, F&& f_) const
+        {
+            for (uint64_t pos = _dequeue; nRecords_;)
+            {
+                const size_t idx  = static_cast<size_t>(pos & _mask);
+                const size_t slot = idx & (ChunkSize - 1);
+                const size_t len  = std::min(nRecords_, ChunkSize - slot);
+                f_(std::span<const T>(_chunks[idx / ChunkSize].load(std::memory_order_relaxed)->items + slot, len));
+                pos      += len;
+                nRecords_ -= len;
+            }
+        }
+        // release the first nRecords_ (at most available()) records for reuse by the producers
+        void consume(size_t nRecords_)
+        {
+            for (; nRecords_; nRecords_--, _dequeue++)
+            {
+                Chunk* chunk = _chunks[(_dequeue & _mask) / ChunkSize].load(std::memory_order_relaxed);
+                chunk->seqs[_dequeue & (ChunkSize - 1)].store(_dequeue + capacity(), std::memory_order_release);
+            }
+        }
+
+    private:
+        struct Chunk
+        {
+            // slot i of the buffer is free for the producer claiming position p when its sequence number
+            // equals p, and holds a record ready for reading at position p when it equals p+1
+            explicit Chunk(uint64_t first_)
+            {
+                for (size_t i = 0; i < ChunkSize; i++)
+                    seqs[i].store(first_ + i, std::memory_order_relaxed);
+            }
+            std::atomic<uint64_t> seqs[ChunkSize];
+            T                     items[ChunkSize];
+        };
+
+        Chunk* getChunk(size_t c_)
+        {
+            Chunk* chunk = _chunks[c_].load(std::memory_order_acquire);
+            if (!chunk) [[unlikely]]
+            {
+                // first use of this chunk: allocate it, unless another producer beats us to it
+                auto fresh = new Chunk(c_ * ChunkSize);
+                if (_chunks[c_].compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+                    chunk = fresh;
+                else
+                    delete fresh;
+            }
+            return chunk;
+        }
+
+        template <typename Assign>
+        bool pushImpl(Assign&& assign_)
+        {
+            uint64_t pos = _enqueue.load(std::memory_order_relaxed);
+            Chunk*   chunk;
+            for (;;)
+            {
+                chunk = getChunk(static_cast<size_t>(pos & _mask) / ChunkSize);
+                const auto dif = static_cast<int64_t>(chunk->seqs[pos & (ChunkSize - 1)].load(std::memory_order_acquire) - pos);
+                if (dif == 0)
+                {
+                    if (_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (dif < 0)
+                {
+                    // slot not yet consumed since the previous lap: full
+                    _nDropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                else
+                    pos = _enqueue.load(std::memory_order_relaxed);
+            }
+            assign_(chunk->items[pos & (ChunkSize - 1)]);
+            chunk->seqs[pos & (ChunkSize - 1)].store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        const size_t                            _nChunk;
+        const uint64_t                          _mask;
+        std::unique_ptr<std::atomic<Chunk*>[]>  _chunks;
+        alignas(64) std::atomic<uint64_t>       _enqueue{ 0 };  // next position to claim (producers)
+        alignas(64) std::atomic<uint64_t>       _nDropped{ 0 };
+        alignas(64) uint64_t                    _dequeue = 0;   // next position to read (consumer)
+    };
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+
+// kernels for the linear conversion of arrays of numbers to and from double, e.g. from counts of clock
+// ticks to seconds:
+// apply : out_[i] = static_cast<double>(in_[i]) * scale_ + offset_
+// invert: out_[i] = static_cast<Out>((in_[i] - offset_) * invScale_), rounded to nearest for integer Out.
+//         Values that are not finite or out of the range of Out are not converted, see below
+// The loops are simple enough for the compiler to vectorise, except for int64 input: there is no vector
+// conversion from int64 to double before AVX-512. With AVX2 it is done with integer arithmetic instead
+// (exact, so with the same result as the scalar conversion). apply() may be done in place (in_ == out_)
+namespace scale_offset
+{
+    namespace detail
+    {
+        // whether v_ (rounded already for integer Out) can be converted to Out. False for NaN and Inf
+        template <typename Out>
+        bool inRange(double v_)
+        {
+            if constexpr (std::is_integral_v<Out>)
+            {
+                // NB: the bounds are powers of 2, so exactly representable
+                constexpr double hi = []
+                {
+                    double out = 1;
+                    for (int i = 0; i < std::numeric_limits<Out>::digits; i++)
+                        out *= 2;
+                    return out;
+                }();
+                constexpr double lo = std::is_signed_v<Out> ? -hi : 0.;
+                return v_ >= lo && v_ < hi;
+            }
+            else
+                return v_ >= -static_cast<double>(std::numeric_limits<Out>::max()) && v_ <= static_cast<double>(std::numeric_limits<Out>::max());
+        }
+
+#if defined(__AVX2__)
+        // x = hi*2^32 + lo, with hi the signed upper and lo the unsigned lower half. Both halves convert
+        // exactly, as does the multiplication by 2^32, so the sum is the only rounding step
+        inline __m256d int64ToDouble(__m256i x_)
+        {
+            const __m128i hi   = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(x_, _mm256_setr_epi32(1, 3, 5, 7, 1, 3, 5, 7)));
+            const __m256d hiD  = _mm256_mul_pd(_mm256_cvtepi32_pd(hi), _mm256_set1_pd(4294967296.));
+            // lo: put it in the mantissa of 2^52, and subtract that
+            const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+            const __m256d loD  = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_blend_epi32(x_, magic, 0b10101010)), _mm256_castsi256_pd(magic));
+            return _mm256_add_pd(hiD, loD);
+        }
+#endif
+    }
+
+    template <typename In>
+    void apply(const In* in_, size_t n_, double scale_, double offset_, double* out_)
+    {
+        size_t i = 0;
+#if defined(__AVX2__)
+        if constexpr (std::is_integral_v<In> && std::is_signed_v<In> && sizeof(In) == 8)
+        {
+            const __m256d s = _mm256_set1_pd(scale_);
+            const __m256d o = _mm256_set1_pd(offset_);
+            for (; i + 4 <= n_; i += 4)
+            {
+                const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in_ + i));
+                _mm256_storeu_pd(out_ + i, _mm256_add_pd(_mm256_mul_pd(detail::int64ToDouble(x), s), o));
+            }
+        }
+#endif
+        for (; i < n_; i++)
+            out_[i] = static_cast<double>(in_[i]) * scale_ + offset_;
+    }
+
+    // returns the index of the first element that is not finite or whose converted value is out of the range of
+    // Out, n_ if there is none. The range check is done in the same (branch-free) pass, an offending element's
+    // output is set to 0. Only once a block contains an offending element is it searched for the first one
+    template <typename Out>
+    size_t invert(const double* in_, size_t n_, double invScale_, double offset_, Out* out_)
+    {
+        auto convert = [invScale_, offset_](double v_)
+        {
+            const double v = (v_ - offset_) * invScale_;
+            if constexpr (std::is_integral_v<Out>)
+                return std::nearbyint(v);
+            else
+                return v;
+        };
+        constexpr size_t blockSize = 256;
+        for (size_t b = 0; b < n_; b += blockSize)
+        {
+            const size_t e = std::min(n_, b + blockSize);
+            bool ok = true;
+            for (size_t i = b; i < e; i++)
+            {
+                const double v  = convert(in_[i]);
+                const bool   vOk = detail::inRange<Out>(v);
+                ok &= vOk;
+                out_[i] = static_cast<Out>(vOk ? v : 0.);
+            }
+            if (!ok)
+                for (size_t i = b; i < e; i++)
+                    if (!detail::inRange<Out>(convert(in_[i])))
+                        return i;
+        }
+        return n_;
+    }
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// single-producer single-consumer ring buffer of fixed-size records in POSIX shared memory, for handing
+// data from another process (e.g. an acquisition process) to a mex file without serialization. The
+// producer creates the region and pushes records, the consumer (typically the mex file) opens it and
+// reads records in place. Head (write) and tail (read) positions are lock-free atomics in the shared
+// region, so record types must be trivially copyable and must have the same layout in both processes
+// (compile both with the same compiler and settings). A record-type tag is stored in the region and
+// checked when opening, to catch mismatches.
+//
+// producer:
+// auto ring = shm_ring::Ring<Sample>::create("/myAcq", 1<<20);
+// ring.push(sample);
+// consumer:
+// auto ring = shm_ring::Ring<Sample>::open("/myAcq");
+// auto segs = ring.peek();    // up to two contiguous segments (the second non-empty when wrapping around)
+// ... use segs[0] and segs[1] ...
+// ring.consume(segs[0].size() + segs[1].size());
+//
+// Errors throw a std::string.
+namespace shm_ring
+{
+    namespace detail
+    {
+        inline constexpr uint64_t magic = 0x53574147'52494E47ull;  // "SWAGRING"
+
+        struct Header
+        {
+            uint64_t magic;
+            uint64_t recordSize;
+            uint64_t recordTag;
+            uint64_t capacity;                                      // number of records, power of two
+            alignas(64) std::atomic<uint64_t> head;                 // total number of records written
+            alignas(64) std::atomic<uint64_t> tail;                 // total number of records read
+        };
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory ring requires lock-free 64-bit atomics");
+        inline constexpr size_t dataOffset = (sizeof(Header) + 63) / 64 * 64;
+
+        inline std::string errorString(const char* what_, const std::string& name_)
+        {
+            return std::string("SWAG::shm_ring: ") + what_ + " \"" + name_ + "\": " + std::strerror(errno);
+        }
+    }
+
+    template <typename T>
+    class Ring
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "records in a shared memory ring must be trivially copyable");
+    public:
+        // create (or recreate) the shared memory region. Capacity is rounded up to a power of two.
+        // recordTag_ can be used to identify the record type/version, open() fails if it does not match
+        static Ring create(const std::string& name_, size_t capacity_, uint64_t recordTag_ = 0)
+        {
+            const uint64_t capacity = std::bit_ceil(std::max<uint64_t>(capacity_, 1));
+            const size_t   size     = detail::dataOffset + capacity * sizeof(T);
+
+            const int fd = ::shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+            if (fd < 0)
+                throw detail::errorString("cannot create", name_);
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                const auto err = detail::errorString("cannot size", name_);
+                ::close(fd);
+                throw err;
+            }
+            Ring out(name_, fd, size);
+            auto hdr = new (out._base) detail::Header{ detail::magic, sizeof(T), recordTag_, capacity, {0}, {0} };
+            out.setup(hdr);
+            return out;
+        }
+        // open an existing region, created by create() with the same record type
+        static Ring open(const std::string& name_, uint64_t recordTag_ = 0)
+        {
+            const int fd = ::shm_open(name_.c_str(), O_RDWR, 0);
+            if (fd < 0)
+                throw detail::errorString("cannot open", name_);
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < detail::dataOffset)
+            {
+                ::close(fd);
+                throw "SWAG::shm_ring: \"" + name_ + "\" is not a ring buffer.";
+            }
+            Ring out(name_, fd, static_cast<size_t>(st.st_size));
+            auto hdr = std::launder(reinterpret_cast<detail::Header*>(out._base));
+            if (hdr->magic != detail::magic || hdr->recordSize != sizeof(T) || hdr->recordTag != recordTag_ ||
+                !std::has_single_bit(hdr->capacity) || detail::dataOffset + hdr->capacity * sizeof(T) > out._size)
+                throw "SWAG::shm_ring: \"" + name_ + "\" is not a ring buffer of the requested record type.";
+            out.setup(hdr);
+            return out;
+        }
+        // remove the name of the shared memory region. Mappings that are already open remain valid
+        static void unlink(const std::string& name_)
+        {
+            ::shm_unlink(name_.c_str());
+        }
+
+        Ring(Ring&& other_) noexcept :
+            _name(std::move(other_._name)), _base(std::exchange(other_._base, nullptr)), _size(other_._size),
+            _hdr(other_._hdr), _data(other_._data), _mask(other_._mask) {}
+        Ring& operator=(Ring&& other_) noexcept
+        {
+            if (this != &other_)
+            {
+                unmap();
+                _name = std::move(other_._name);
+                _base = std::exchange(other_._base, nullptr);
+                _size = other_._size;
+                _hdr  = other_._hdr;
+                _data = other_._data;
+                _mask = other_._mask;
+            }
+            return *this;
+        }
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+        ~Ring() { unmap(); }
+
+        size_t capacity() const { return static_cast<size_t>(_mask + 1); }
+        // number of records available for reading (a snapshot, the other side may be running concurrently)
+        size_t size() const
+        {
+            return static_cast<size_t>(_hdr->head.load(std::memory_order_acquire) - _hdr->tail.load(std::memory_order_acquire));
+        }
+
+        //// producer side
+        // push as many of the records as fit, returns the number pushed
+        size_t push(std::span<const T> records_)
+        {
+            const uint64_t head = _hdr->head.load(std::memory_order_relaxed);
+            const uint64_t tail = _hdr->tail.load(std::memory_order_acquire);
+            const size_t   n    = std::min(records_.size(), static_cast<size_t>(capacity() - (head - tail)));
+            const size_t   pos  = static_cast<size_t>(head & _mask);
+            const size_t   n1   = std::min(n, capacity() - pos);
+            std::memcpy(_data + pos, records_.data(), n1 * sizeof(T));
+            std::memcpy(_data, records_.data() + n1, (n - n1) * sizeof(T));
+            _hdr->head.store(head + n, std::memory_order_release);
+            return n;
+        }
+        bool push(const T& record_)
+        {
+            return push(std::span<const T>(&record_, 1)) == 1;
+        }
+
+        //// consumer side
+        // view of (at most maxRecords_) records available for reading, as two contiguous segments. The
+        // records remain valid until consume() is called
+        std::array<std::span<const T>, 2> peek(size_t maxRecords_ = static_cast<size_t>(-1)) const
+        {
+            const uint64_t tail = _hdr->tail.load(std::memory_order_relaxed);
+            const uint64_t head = _hdr->head.load(std::memory_order_acquire);
+            const size_t   n    = std::min(maxRecords_, static_cast<size_t>(head - tail));
+            const size_t   pos  = static_cast<size_t>(tail & _mask);
+            const size_t   n1   = std::min(n, capacity() - pos);
+            return { std::span<const T>(_data + pos, n1), std::span<const T>(_data, n - n1) };
+        }
+        // release records (obtained through peek()) for reuse by the producer
+        void consume(size_t nRecords_)
+        {
+            _hdr->tail.fetch_add(nRecords_, std::memory_order_release);
+        }
+
+    private:
+        Ring(std::string name_, int fd_, size_t size_) : _name(std::move(name_)), _size(size_)
+        {
+            void* base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            ::close(fd_);
+            if (base == MAP_FAILED)
+                throw detail::errorString("cannot map", _name);
+            _base = static_cast<std::byte*>(base);
+        }
+        void setup(detail::Header* hdr_)
+        {
+            _hdr  = hdr_;
+            _data = reinterpret_cast<T*>(_base + detail::dataOffset);
+            _mask = hdr_->capacity - 1;
+        }
+        void unmap()
+        {
+            if (_base)
+                ::munmap(_base, _size);
+            _base = nullptr;
+        }
+
+        std::string     _name;
+        std::byte*      _base = nullptr;
+        size_t          _size = 0;
+        detail::Header* _hdr  = nullptr;
+        T*              _data = nullptr;
+        uint64_t        _mask = 0;
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+
+// kernels for extracting a field at a constant byte offset from each element of an array of structs
+// (i.e., a strided load), converting it to the output type on the fly:
+// out_[i] = static_cast<Out>(value of type In at base_ + i*stride_), for i in [0, n_)
+// With AVX2, 4- and 8-byte fields are fetched with gather instructions (float and int32 fields
+// converted to double in-register), else with an unrolled loop.
+namespace strided_gather
+{
+    namespace detail
+    {
+        template <typename In>
+        inline In load(const std::byte* p_)
+        {
+            In v;
+            std::memcpy(&v, p_, sizeof(In));
+            return v;
+        }
+
+#if defined(__AVX2__)
+        // returns number of elements done, remainder is left to the scalar loop
+        template <typename In, typename Out>
+        size_t gatherAvx2(const std::byte* base_, size_t stride_, size_t n_, Out* out_)
+        {
+            // indices are 32-bit and relative to a base that is advanced per batch, so only the offsets within
+            // a batch need to fit
+            if (stride_ > INT32_MAX / 8)
+                return 0;
+            const auto s = static_cast<int>(stride_);
+            // NB: masked gathers (all lanes enabled) with a zeroed source, the unmasked intrinsics leave the
+            // source undefined which trips up -Wmaybe-uninitialized
+            const __m256i all = _mm256_set1_epi32(-1);
+            size_t i = 0;
+            if constexpr (sizeof(In) == 8 && std::is_same_v<In, Out>)
+            {
+                const __m128i idx = _mm_setr_epi32(0, s, 2 * s, 3 * s);
+                for (; i + 4 <= n_; i += 4, base_ += 4 * stride_)
+                {
+                    if constexpr (std::is_same_v<In, double>)
+                        _mm256_storeu_pd(out_ + i, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), reinterpret_cast<const double*>(base_), idx, _mm256_castsi256_pd(all), 1));
+                    else
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out_ + i), _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), reinterpret_cast<const long long*>(base_), idx, all, 1));
+                }
+            }
+            else if constexpr (sizeof(In) == 4 && std::is_same_v<In, Out>)
+            {
+                const __m256i idx = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+                for (; i + 8 <= n_; i += 8, base_ += 8 * stride_)
+                {
+                    if constexpr (std::is_same_v<In, float>)
+                        _mm256_storeu_ps(out_ + i, _mm256_mask_i32gather_ps(_mm256_setzero_ps(), reinterpret_cast<const float*>(base_), idx, _mm256_castsi256_ps(all), 1));
+                    else
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out_ + i), _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(base_), idx, all, 1));
+                }
+            }
+            else if constexpr (std::is_same_v<Out, double> && (std::is_same_v<In, float> || std::is_same_v<In, int32_t>))
+            {
+                const __m128i idx = _mm_setr_epi32(0, s, 2 * s, 3 * s);
+                for (; i + 4 <= n_; i += 4, base_ += 4 * stride_)
+                {
+                    if constexpr (std::is_same_v<In, float>)
+                        _mm256_storeu_pd(out_ + i, _mm256_cvtps_pd(_mm_mask_i32gather_ps(_mm_setzero_ps(), reinterpret_cast<const float*>(base_), idx, _mm256_castps256_ps128(_mm256_castsi256_ps(all)), 1)));
+                    else
+                        _mm256_storeu_pd(out_ + i, _mm256_cvtepi32_pd(_mm_mask_i32gather_epi32(_mm_setzero_si128(), reinterpret_cast<const int*>(base_), idx, _mm256_castsi256_si128(all), 1)));
+                }
+            }
+            return i;
+        }
+#endif
+    }
+
+    template <typename In, typename Out>
+    void gather(const std::byte* base_, size_t stride_, size_t n_, Out* out_)
+    {
+        static_assert(std::is_arithmetic_v<In> && std::is_arithmetic_v<Out>);
+        size_t i = 0;
+#if defined(__AVX2__)
+        i = detail::gatherAvx2<In>(base_, stride_, n_, out_);
+#endif
+        const std::byte* p = base_ + i * stride_;
+        for (; i + 4 <= n_; i += 4, p += 4 * stride_)
+        {
+            const In v0 = detail::load<In>(p);
+            const In v1 = detail::load<In>(p + stride_);
+            const In v2 = detail::load<In>(p + 2 * stride_);
+            const In v3 = detail::load<In>(p + 3 * stride_);
+            out_[i]     = static_cast<Out>(v0);
+            out_[i + 1] = static_cast<Out>(v1);
+            out_[i + 2] = static_cast<Out>(v2);
+            out_[i + 3] = static_cast<Out>(v3);
+        }
+        for (; i < n_; i++, p += stride_)
+            out_[i] = static_cast<Out>(detail::load<In>(p));
+    }
+}
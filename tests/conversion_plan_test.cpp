@@ -0,0 +1,136 @@
+// checks that the outputs of a ConversionPlan (mex_conversion_plan.h) are identical to those of the
+// corresponding mxTypes functions, for each kind of input the planner handles itself and for the type and
+// layout tags it forwards. Needs the mx API of MATLAB, but no running MATLAB session:
+// mex -client engine -I.. CXXFLAGS='$CXXFLAGS -std=c++20' conversion_plan_test.cpp && ./conversion_plan_test
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "mex_conversion_plan.h"
+
+namespace
+{
+    enum class Event { Fixation, Saccade, Blink };
+
+    struct Sample
+    {
+        int64_t                   ts;
+        float                     x;
+        std::string               label;
+        std::vector<double>       trace;
+        Event                     event;
+        std::chrono::microseconds latency;
+    };
+}
+
+template <>
+struct mxTypes::enumNames<Event>
+{
+    static constexpr std::array value = { std::pair{ Event::Fixation, std::string_view{ "fixation" } }, std::pair{ Event::Saccade, std::string_view{ "saccade" } }, std::pair{ Event::Blink, std::string_view{ "blink" } } };
+};
+
+namespace
+{
+    bool identical(const mxArray* a_, const mxArray* b_)
+    {
+        if (mxGetClassID(a_) != mxGetClassID(b_) || mxGetM(a_) != mxGetM(b_) || mxGetN(a_) != mxGetN(b_))
+            return false;
+        const size_t n = mxGetNumberOfElements(a_);
+        if (mxIsCell(a_))
+        {
+            for (size_t i = 0; i < n; i++)
+                if (!identical(mxGetCell(a_, i), mxGetCell(b_, i)))
+                    return false;
+            return true;
+        }
+        if (mxIsStruct(a_))
+        {
+            if (mxGetNumberOfFields(a_) != mxGetNumberOfFields(b_))
+                return false;
+            for (int f = 0; f < mxGetNumberOfFields(a_); f++)
+            {
+                if (std::strcmp(mxGetFieldNameByNumber(a_, f), mxGetFieldNameByNumber(b_, f)))
+                    return false;
+                for (size_t i = 0; i < n; i++)
+                    if (!identical(mxGetFieldByNumber(a_, i, f), mxGetFieldByNumber(b_, i, f)))
+                        return false;
+            }
+            return true;
+        }
+        return !n || std::memcmp(mxGetData(a_), mxGetData(b_), n * mxGetElementSize(a_)) == 0;
+    }
+
+    int nFailed = 0;
+
+    // planned_ must be an output of plan_, which is executed first
+    void check(const char* what_, mxTypes::ConversionPlan& plan_, mxArray* planned_, mxArray* direct_)
+    {
+        plan_.execute();
+        const bool ok = identical(planned_, direct_);
+        nFailed += !ok;
+        std::printf("%s: %s\n", ok ? "ok  " : "FAIL", what_);
+        mxDestroyArray(planned_);
+        mxDestroyArray(direct_);
+    }
+}
+
+int main()
+{
+    using namespace mxTypes;
+    try
+    {
+        std::vector<Sample> samples;
+        for (int i = 0; i < 100'000; i++)
+            samples.push_back({ i, i * .25f, "sample " + std::to_string(i), std::vector<double>(i % 5, i), static_cast<Event>(i % 3), std::chrono::microseconds(7 * i) });
+        const std::vector<std::string>                names = { "a", "b\xC3\xA9", "\xE6\x97\xA5\xE6\x9C\xAC", "\xF0\x9F\x98\x80x", "" };
+        const std::list<double>                       values = { 1., 2.5, -3. };
+        const std::vector<std::vector<double>>        ragged = { { 1., 2. }, {}, { 3. } };
+        const std::vector<std::vector<double>>        rectangular = { { 1., 2. }, { 3., 4. } };
+        const std::vector<std::vector<std::string>>   nested = { { "x", "y" }, { "z" } };
+        const std::vector<std::optional<double>>      optionals = { 1., std::nullopt, 3. };
+        const std::vector<std::optional<int32_t>>     optionalInts = { 1, std::nullopt };
+        const std::vector<Event>                      events = { Event::Blink, Event::Fixation, Event::Blink };
+        const std::list<std::chrono::milliseconds>    durations = { std::chrono::milliseconds(3), std::chrono::milliseconds(-1) };
+
+        ConversionPlan plan;
+        check("strings", plan, plan.ToMatlab(names), ToMatlab(names));
+        check("list with type tag", plan, plan.ToMatlab(values, int32_t{}), ToMatlab(values, int32_t{}));
+        check("nested strings", plan, plan.ToMatlab(nested), ToMatlab(nested));
+        check("vector of vectors", plan, plan.ToMatlab(ragged), ToMatlab(ragged));
+        check("vector of vectors with type tag", plan, plan.ToMatlab(ragged, float{}), ToMatlab(ragged, float{}));
+        check("Ragged", plan, plan.ToMatlab(ragged, Ragged{}), ToMatlab(ragged, Ragged{}));
+        check("Ragged dense if rectangular", plan, plan.ToMatlab(rectangular, Ragged{ true }), ToMatlab(rectangular, Ragged{ true }));
+        check("optionals", plan, plan.ToMatlab(optionals), ToMatlab(optionals));
+        check("Dense optional floating point", plan, plan.ToMatlab(optionals, Dense{}), ToMatlab(optionals, Dense{}));
+        check("Dense optional integer", plan, plan.ToMatlab(optionalInts, Dense{}), ToMatlab(optionalInts, Dense{}));
+        check("enums", plan, plan.ToMatlab(events), ToMatlab(events));
+        check("EnumCodes", plan, plan.ToMatlab(events, EnumCodes{}), ToMatlab(events, EnumCodes{}));
+        check("EnumCategorical", plan, plan.ToMatlab(events, EnumCategorical{}), ToMatlab(events, EnumCategorical{}));
+        check("durations", plan, plan.ToMatlab(durations), ToMatlab(durations));
+        check("durations with encoding", plan, plan.ToMatlab(durations, Seconds{}), ToMatlab(durations, Seconds{}));
+        check("field", plan, plan.FieldToMatlab(samples, true, &Sample::x), FieldToMatlab(samples, true, &Sample::x));
+        check("string field", plan, plan.FieldToMatlab(samples, false, &Sample::label), FieldToMatlab(samples, false, &Sample::label));
+        check("container field", plan, plan.FieldToMatlab(samples, false, &Sample::trace), FieldToMatlab(samples, false, &Sample::trace));
+        check("std::chrono field", plan, plan.FieldToMatlab(samples, false, &Sample::latency), FieldToMatlab(samples, false, &Sample::latency));
+        check("std::chrono field with encoding", plan, plan.FieldToMatlab(samples, false, &Sample::latency, Seconds{}), FieldToMatlab(samples, false, &Sample::latency, Seconds{}));
+        check("columns", plan,
+            plan.FieldsToMatlab(samples, false, Column("ts", &Sample::ts), Column("x", &Sample::x, double{}), Column("label", &Sample::label), Column("trace", &Sample::trace), Column("event", &Sample::event), Column("latency", &Sample::latency),
+                Column("double", &Sample::ts, [](int64_t ts_) { return std::to_string(2 * ts_); })),
+            FieldsToMatlab(samples, false, Column("ts", &Sample::ts), Column("x", &Sample::x, double{}), Column("label", &Sample::label), Column("trace", &Sample::trace), Column("event", &Sample::event), Column("latency", &Sample::latency),
+                Column("double", &Sample::ts, [](int64_t ts_) { return std::to_string(2 * ts_); })));
+    }
+    catch (const std::string& e_)
+    {
+        std::printf("%s\n", e_.c_str());
+        return 1;
+    }
+    return nFailed ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#!/bin/sh
+# compile time and object size of a translation unit reading the common argument types, with and without
+# MEX_INPUT_GETTER_EXTERN_COMMON (see the end of mex_input_getter.h), and the one-off cost of the
+# translation unit instantiating them. Usage, extra arguments are passed to the compiler:
+# MATLAB_INCLUDE=/usr/local/MATLAB/R2024a/extern/include tests/extern_common_compile.sh -O2
+set -e
+CXX=${CXX:-g++}
+here=$(cd "$(dirname "$0")" && pwd)
+inc="-I$here/.. -I${MATLAB_INCLUDE:?set MATLAB_INCLUDE to the extern/include directory of MATLAB}"
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+# label, source, flags...
+measure()
+{
+    label=$1
+    src=$2
+    shift 2
+    start=$(date +%s.%N)
+    $CXX -std=c++20 $inc "$@" -c "$here/$src" -o "$out/obj.o"
+    end=$(date +%s.%N)
+    printf '%-32s %6.2f s %10d bytes\n' "$label" "$(awk "BEGIN { print $end - $start }")" "$(wc -c < "$out/obj.o")"
+}
+
+measure "no extern" extern_common_tu.cpp "$@"
+measure "MEX_INPUT_GETTER_EXTERN_COMMON" extern_common_tu.cpp -DMEX_INPUT_GETTER_EXTERN_COMMON "$@"
+measure "instantiating TU (once)" extern_common_instantiate.cpp -DMEX_INPUT_GETTER_EXTERN_COMMON "$@"
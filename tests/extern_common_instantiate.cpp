@@ -0,0 +1,4 @@
+// the one translation unit instantiating the common FromMatlab types, see extern_common_compile.sh
+#include "mex_type_utils.h"
+#define MEX_INPUT_GETTER_INSTANTIATE_COMMON
+#include "mex_input_getter.h"
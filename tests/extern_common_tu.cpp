@@ -0,0 +1,22 @@
+// translation unit reading arguments of the common types (see MEX_INPUT_GETTER_COMMON_TYPES at the end of
+// mex_input_getter.h), compiled by extern_common_compile.sh with and without MEX_INPUT_GETTER_EXTERN_COMMON
+#include "mex_type_utils.h"
+#include "mex_input_getter.h"
+
+// expects 24 arguments. Each ParseArgs call gets its own slice of them (the argument count up to the end of
+// its slice), and the values are combined into a checksum so that none of them is unused
+double parseCommon(int nrhs, const mxArray* prhs[])
+{
+    if (nrhs != 24)
+        return 0.;
+    auto [b, d, f, i8, i16, i32, i64] = mxTypes::ParseArgs<bool, double, float, int8_t, int16_t, int32_t, int64_t>(7, prhs, "parseCommon", 0);
+    auto [u8, u16, u32, u64, s] = mxTypes::ParseArgs<uint8_t, uint16_t, uint32_t, uint64_t, std::string>(12, prhs, "parseCommon", 7);
+    auto [vd, vf, vi32, vi64, vu64, vs] = mxTypes::ParseArgs<std::vector<double>, std::vector<float>, std::vector<int32_t>, std::vector<int64_t>, std::vector<uint64_t>, std::vector<std::string>>(18, prhs, "parseCommon", 12);
+    auto [ob, od, oi32, oi64, ou64, os] = mxTypes::ParseArgs<std::optional<bool>, std::optional<double>, std::optional<int32_t>, std::optional<int64_t>, std::optional<uint64_t>, std::optional<std::string>>(24, prhs, "parseCommon", 18);
+
+    double sum = b + d + f + i8 + i16 + i32 + static_cast<double>(i64);
+    sum += u8 + u16 + u32 + static_cast<double>(u64) + static_cast<double>(s.size());
+    sum += static_cast<double>(vd.size() + vf.size() + vi32.size() + vi64.size() + vu64.size() + vs.size());
+    sum += ob.value_or(false) + od.value_or(0.) + oi32.value_or(0) + static_cast<double>(oi64.value_or(0) + ou64.value_or(0)) + static_cast<double>(os.value_or("").size());
+    return sum;
+}
@@ -0,0 +1,114 @@
+// two-process test of shm_ring.h: a forked producer pushes numbered records in batches of varying size
+// through a small ring, the consumer checks that the sequence arrives complete and in order, across many
+// wraparounds (including records split over both peek() segments). Needs no MATLAB:
+// g++ -std=c++20 -O2 -I.. shm_ring_test.cpp -o shm_ring_test && ./shm_ring_test     (add -lrt on older glibc)
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+
+namespace
+{
+    struct Record
+    {
+        uint64_t seq;
+        uint64_t check;     // derived from seq, catches torn or stale records
+        double   payload[2];
+    };
+    uint64_t checkValue(uint64_t seq_) { return seq_ * 0x9E3779B97F4A7C15ull ^ 0xA5A5A5A5A5A5A5A5ull; }
+
+    constexpr size_t   capacity = 61;          // rounded up to 64, not a divisor of the batch sizes
+    constexpr uint64_t nRecord  = 2'000'000;
+
+    int produce(const std::string& name_)
+    {
+        auto ring = shm_ring::Ring<Record>::open(name_, 7);
+        std::vector<Record> batch;
+        uint64_t seq = 0;
+        for (size_t round = 0; seq < nRecord; round++)
+        {
+            batch.clear();
+            const size_t n = 1 + round % 37;
+            for (size_t i = 0; i < n && seq + i < nRecord; i++)
+                batch.push_back({ seq + i, checkValue(seq + i), { static_cast<double>(seq + i), -1. } });
+            // push whole batches only, so the ring does not fill up to the consumer's position, which would
+            // make both sides advance in steps of the capacity and never split a read
+            while (ring.capacity() - ring.size() < batch.size())
+                ::sched_yield();
+            if (ring.push(batch) != batch.size())
+                return 1;
+            seq += batch.size();
+        }
+        return 0;
+    }
+
+    bool consume(shm_ring::Ring<Record>& ring_)
+    {
+        uint64_t expected = 0, nSplit = 0;
+        for (size_t round = 0; expected < nRecord; round++)
+        {
+            auto segs = ring_.peek(1 + round % 23);
+            if (segs[0].empty())
+            {
+                ::sched_yield();
+                continue;
+            }
+            nSplit += !segs[1].empty();
+            for (const auto& seg : segs)
+                for (const auto& r : seg)
+                {
+                    if (r.seq != expected || r.check != checkValue(r.seq) || r.payload[0] != static_cast<double>(r.seq))
+                    {
+                        std::printf("FAIL: expected record %llu, got seq %llu\n", static_cast<unsigned long long>(expected), static_cast<unsigned long long>(r.seq));
+                        return false;
+                    }
+                    expected++;
+                }
+            ring_.consume(segs[0].size() + segs[1].size());
+        }
+        if (ring_.size() != 0 || !nSplit)
+        {
+            std::printf("FAIL: %zu records left over, %llu split reads\n", ring_.size(), static_cast<unsigned long long>(nSplit));
+            return false;
+        }
+        std::printf("ok: %llu records, %llu wraparounds, %llu split reads\n", static_cast<unsigned long long>(nRecord),
+            static_cast<unsigned long long>(nRecord / ring_.capacity()), static_cast<unsigned long long>(nSplit));
+        return true;
+    }
+}
+
+int main()
+{
+    const std::string name = "/swag_shm_ring_test_" + std::to_string(::getpid());
+    try
+    {
+        auto ring = shm_ring::Ring<Record>::create(name, capacity, 7);
+        const pid_t pid = ::fork();
+        if (pid < 0)
+            throw std::string("fork failed");
+        if (pid == 0)
+        {
+            int ret = 1;
+            try { ret = produce(name); }
+            catch (const std::string& e_) { std::printf("producer: %s\n", e_.c_str()); }
+            ::_exit(ret);
+        }
+
+        const bool ok = consume(ring);
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        shm_ring::Ring<Record>::unlink(name);
+        return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+    }
+    catch (const std::string& e_)
+    {
+        std::printf("%s\n", e_.c_str());
+        shm_ring::Ring<Record>::unlink(name);
+        return 1;
+    }
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// a small pool of worker threads, for work that does not touch the MATLAB API (the mx API must only be
+// used from the mex thread). Jobs are run in submission order by the first available worker.
+// parallelFor() distributes a loop over the workers and the calling thread and returns once it is done.
+//
+// Default() is a process-wide pool that is started on first use. When it is used from a mex file, stop
+// its threads when the mex file is unloaded:
+// mexAtExit([] { worker_pool::Default().stop(); });
+namespace worker_pool
+{
+    class Pool
+    {
+    public:
+        explicit Pool(size_t nThreads_ = std::max(std::thread::hardware_concurrency(), 2u) - 1)
+        {
+            _threads.reserve(nThreads_);
+            for (size_t t = 0; t < nThreads_; t++)
+                _threads.emplace_back([this] { run(); });
+        }
+        ~Pool() { stop(); }
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        size_t size() const { return _threads.size(); }
+
+        // run job_ on a worker. The job should not throw
+        void submit(std::function<void()> job_)
+        {
+            {
+                std::lock_guard lock(_mutex);
+                _jobs.push_back(std::move(job_));
+            }
+            _cv.notify_one();
+        }
+
+        // invoke f_(i) for each i in [0, n_), concurrently on the workers and the calling thread. Returns
+        // when all invocations have completed. If any invocation throws, the remaining indices are skipped
+        // and the first exception is rethrown
+        template <typename F>
+        void parallelFor(size_t n_, F&& f_)
+        {
+            if (!n_)
+                return;
+            // NB: state is shared with the helper jobs, which may only get to run after all indices have
+            // been handled and this function has returned
+            struct State
+            {
+                std::atomic<size_t>         next{ 0 };
+                std::atomic<size_t>         done{ 0 };
+                std::atomic<bool>           failed{ false };
+                size_t                      n;
+                std::function<void(size_t)> f;
+                std::mutex                  mutex;
+                std::condition_variable     cv;
+                std::exception_ptr          error;
+            };
+            auto state = std::make_shared<State>();
+            state->n   = n_;
+            state->f   = std::ref(f_);
+            auto work = [](State& s_)
+            {
+                size_t nDone = 0;
+                for (size_t i; (i = s_.next.fetch_add(1, std::memory_order_relaxed)) < s_.n; nDone++)
+                {
+                    if (s_.failed.load(std::memory_order_relaxed))
+                        continue;   // skip remaining work
+                    try
+                    {
+                        s_.f(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lock(s_.mutex);
+                        if (!s_.error)
+                            s_.error = std::current_exception();
+                        s_.failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+                if (nDone && s_.done.fetch_add(nDone, std::memory_order_acq_rel) + nDone == s_.n)
+                {
+                    std::lock_guard lock(s_.mutex);
+                    s_.cv.notify_all();
+                }
+            };
+            for (size_t t = 0, nHelp = std::min(size(), n_ - 1); t < nHelp; t++)
+                submit([state, work] { work(*state); });
+            work(*state);
+
+            // wait for the helpers to finish the indices they claimed
+            std::unique_lock lock(state->mutex);
+            state->cv.wait(lock, [&] { return state->done.load(std::memory_order_acquire) == state->n; });
+            if (state->error)
+                std::rethrow_exception(state->error);
+        }
+
+        // stop and join the workers, after finishing the jobs already submitted
+        void stop()
+        {
+            {
+                std::lock_guard lock(_mutex);
+                _stopping = true;
+            }
+            _cv.notify_all();
+            for (auto& t : _threads)
+                if (t.joinable())
+                    t.join();
+            _threads.clear();
+        }
+
+    private:
+        void run()
+        {
+            for (;;)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock lock(_mutex);
+                    _cv.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+                    if (_jobs.empty())
+                        return;
+                    job = std::move(_jobs.front());
+                    _jobs.pop_front();
+                }
+                job();
+            }
+        }
+
+        std::vector<std::thread>            _threads;
+        std::deque<std::function<void()>>   _jobs;
+        std::mutex                          _mutex;
+        std::condition_variable             _cv;
+        bool                                _stopping = false;
+    };
+
+    // process-wide pool, started on first use
+    inline Pool& Default()
+    {
+        static Pool pool;
+        return pool;
+    }
+}